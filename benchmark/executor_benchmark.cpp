@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <inttypes.h>
+#include <gflags/gflags.h>
+#include <base/logging.h>
+#include <joewu/graph/engine/graph.h>
+#include <joewu/graph/engine/data.h>
+#include <joewu/graph/engine/vertex.h>
+#include <joewu/graph/engine/builder.h>
+#include <joewu/graph/engine/closure.h>
+#include <joewu/graph/engine/executor.h>
+#include <joewu/graph/engine/work_stealing_executor.h>
+#include <joewu/graph/engine/serial_executor.h>
+#include "../test/sum_processor.h"
+
+DEFINE_string(executor, "all", "bthread|work_stealing|serial|all");
+DEFINE_string(shape, "all", "chain|fan_out|diamond|all");
+DEFINE_uint64(width, 16, "vertex num of chain, or branch num of fan_out and diamond");
+DEFINE_uint64(concurrency, 8, "worker num of work stealing executor");
+DEFINE_uint64(client, 4, "thread num to run graph concurrently");
+DEFINE_uint64(round, 2000, "graph run num of each client");
+DEFINE_uint64(work, 100, "busy loop num in each vertex to simulate calculation");
+DEFINE_uint64(continuation, 0, "max continuation depth, 0 to disable");
+DEFINE_uint64(auto_trivial, 0, "p90 cost threshold in ns to run vertex inplace, 0 to disable");
+
+using ::joewu::feed::graph::GraphBuilder;
+using ::joewu::feed::graph::GraphExecutor;
+using ::joewu::feed::graph::GraphProcessor;
+using ::joewu::feed::graph::GraphVertex;
+using ::joewu::feed::graph::BthreadGraphExecutor;
+using ::joewu::feed::graph::WorkStealingGraphExecutor;
+using ::joewu::feed::graph::SerialGraphExecutor;
+
+// 所有依赖求和加一后输出，附带少量计算模拟实际算子
+class WorkSumProcessor : public SumProcessor {
+    virtual int32_t process(GraphVertex& vertex) noexcept override {
+        volatile uint64_t work = 0;
+        for (uint64_t i = 0; i < FLAGS_work; ++i) {
+            work = work + i;
+        }
+        return SumProcessor::process(vertex);
+    }
+};
+
+static WorkSumProcessor processor;
+
+static void run_case(const ::std::string& executor_name, GraphExecutor& executor,
+    const ::std::string& shape) noexcept {
+    GraphBuilder builder;
+    builder.executor(executor);
+    builder.continuation(FLAGS_continuation);
+    builder.auto_trivial(FLAGS_auto_trivial);
+    if (shape == "chain") {
+        build_chain(builder, processor, FLAGS_width);
+    } else if (shape == "fan_out") {
+        build_fan_out(builder, processor, FLAGS_width);
+    } else {
+        build_wide_diamond(builder, processor, FLAGS_width);
+    }
+    if (0 != builder.finish()) {
+        LOG(WARNING) << "finish builder for shape " << shape << " failed";
+        return;
+    }
+
+    ::std::vector<::std::vector<int64_t>> latencies(FLAGS_client);
+    ::std::atomic<size_t> failed {0};
+    ::std::vector<::std::thread> clients;
+    auto begin = ::std::chrono::steady_clock::now();
+    for (size_t i = 0; i < FLAGS_client; ++i) {
+        clients.emplace_back([&, i] {
+            auto& latency = latencies[i];
+            latency.reserve(FLAGS_round);
+            for (size_t j = 0; j < FLAGS_round; ++j) {
+                auto graph = builder.build();
+                auto a = graph->find_data("A");
+                auto start = ::std::chrono::steady_clock::now();
+                if (0 != graph->run(a).get()) {
+                    failed++;
+                }
+                latency.emplace_back(::std::chrono::duration_cast<::std::chrono::microseconds>(
+                    ::std::chrono::steady_clock::now() - start).count());
+            }
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    auto use_us = ::std::chrono::duration_cast<::std::chrono::microseconds>(
+        ::std::chrono::steady_clock::now() - begin).count();
+
+    ::std::vector<int64_t> all;
+    for (auto& latency : latencies) {
+        all.insert(all.end(), latency.begin(), latency.end());
+    }
+    ::std::sort(all.begin(), all.end());
+    auto percentile = [&] (double p) {
+        return all.empty() ? 0 : all[static_cast<size_t>(p * (all.size() - 1))];
+    };
+    fprintf(stdout, "%-14s %-8s width=%-4zu qps=%-10.1f p50=%-6" PRId64 "us p99=%-6" PRId64
+        "us failed=%zu\n", executor_name.c_str(), shape.c_str(), FLAGS_width,
+        all.size() * 1000000.0 / ::std::max<int64_t>(use_us, 1),
+        percentile(0.5), percentile(0.99), failed.load());
+}
+
+int32_t main(int32_t argc, char** argv) {
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    com_logstat_t logstat;
+    logstat.sysevents = 16;
+    com_device_t dev[1];
+    memcpy(dev[0].type, "TTY", 4);
+    COMLOG_SETSYSLOG(dev[0]);
+    com_openlog("executor_benchmark", dev, 1, &logstat);
+
+    ::std::vector<::std::string> shapes;
+    if (FLAGS_shape == "all") {
+        shapes = {"chain", "fan_out", "diamond"};
+    } else {
+        shapes = {FLAGS_shape};
+    }
+    for (auto& shape : shapes) {
+        if (FLAGS_executor == "all" || FLAGS_executor == "bthread") {
+            run_case("bthread", BthreadGraphExecutor::instance(), shape);
+        }
+        if (FLAGS_executor == "all" || FLAGS_executor == "work_stealing") {
+            WorkStealingGraphExecutor executor(FLAGS_concurrency);
+            run_case("work_stealing", executor, shape);
+        }
+        if (FLAGS_executor == "all" || FLAGS_executor == "serial") {
+            run_case("serial", SerialGraphExecutor::instance(), shape);
+        }
+    }
+    return 0;
+}
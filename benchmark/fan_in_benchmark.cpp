@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gflags/gflags.h>
+#include <base/logging.h>
+#include <joewu/graph/engine/graph.h>
+#include <joewu/graph/engine/data.h>
+#include <joewu/graph/engine/vertex.h>
+#include <joewu/graph/engine/builder.h>
+#include <joewu/graph/engine/closure.h>
+#include <joewu/graph/engine/work_stealing_executor.h>
+
+DEFINE_uint64(width, 256, "branch num fan in to the root vertex");
+DEFINE_uint64(max_concurrency, 0, "max worker num to test, 0 to use hardware concurrency");
+DEFINE_uint64(round, 2000, "graph run num of each worker num");
+DEFINE_uint64(work, 0, "busy loop num in each branch, keep small to expose engine overhead");
+
+using ::joewu::feed::graph::Graph;
+using ::joewu::feed::graph::GraphData;
+using ::joewu::feed::graph::GraphBuilder;
+using ::joewu::feed::graph::GraphProcessor;
+using ::joewu::feed::graph::GraphVertex;
+using ::joewu::feed::graph::WorkStealingGraphExecutor;
+
+// 只发布一个整数，附带可选的少量计算
+class EmitProcessor : public GraphProcessor {
+    virtual int32_t process(GraphVertex& vertex) noexcept override {
+        volatile uint64_t work = 0;
+        for (uint64_t i = 0; i < FLAGS_work; ++i) {
+            work = work + i;
+        }
+        *vertex.anonymous_emit(0)->emit<int64_t>() = 1;
+        return 0;
+    }
+};
+
+static EmitProcessor processor;
+
+// A <- {B1, B2, ..., Bn} <- S
+// S完成后n个分支在各个worker上并发运行，同时递减A的等待计数
+// 相邻分支的vertex和data在内存中连续，运行状态伪共享时扩展性会明显变差
+static void build_fan_in(GraphBuilder& builder, size_t width) noexcept {
+    auto& root = builder.add_vertex(processor);
+    root.anonymous_emit().to("A");
+    for (size_t i = 0; i < width; ++i) {
+        root.anonymous_depend().to("B" + ::std::to_string(i));
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("B" + ::std::to_string(i));
+        v.anonymous_depend().to("S");
+    }
+    auto& source = builder.add_vertex(processor);
+    source.anonymous_emit().to("S");
+}
+
+// 单个实例中vertex和data占用的连续内存，名字和符号表在GraphPlan中共享，不计入
+static size_t instance_bytes(size_t width) noexcept {
+    GraphBuilder builder;
+    build_fan_in(builder, width);
+    if (0 != builder.finish()) {
+        LOG(WARNING) << "finish fan in builder failed";
+        return 0;
+    }
+    auto graph = builder.build();
+    return sizeof(Graph) + graph->vertex_size() * sizeof(GraphVertex)
+        + graph->data_size() * sizeof(GraphData);
+}
+
+// 返回每秒完成的graph运行次数
+static double run_case(size_t concurrency) noexcept {
+    WorkStealingGraphExecutor executor(concurrency);
+    GraphBuilder builder;
+    builder.executor(executor);
+    build_fan_in(builder, FLAGS_width);
+    if (0 != builder.finish()) {
+        LOG(WARNING) << "finish fan in builder failed";
+        return 0;
+    }
+    auto graph = builder.build();
+    auto a = graph->find_data("A");
+    size_t failed = 0;
+    auto begin = ::std::chrono::steady_clock::now();
+    for (size_t i = 0; i < FLAGS_round; ++i) {
+        graph->reset();
+        if (0 != graph->run(a).get()) {
+            failed++;
+        }
+    }
+    auto use_us = ::std::chrono::duration_cast<::std::chrono::microseconds>(
+        ::std::chrono::steady_clock::now() - begin).count();
+    if (failed > 0) {
+        LOG(WARNING) << failed << " runs failed with " << concurrency << " workers";
+    }
+    return FLAGS_round * 1000000.0 / ::std::max<int64_t>(use_us, 1);
+}
+
+int32_t main(int32_t argc, char** argv) {
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    com_logstat_t logstat;
+    logstat.sysevents = 16;
+    com_device_t dev[1];
+    memcpy(dev[0].type, "TTY", 4);
+    COMLOG_SETSYSLOG(dev[0]);
+    com_openlog("fan_in_benchmark", dev, 1, &logstat);
+
+    size_t max_concurrency = FLAGS_max_concurrency;
+    if (max_concurrency == 0) {
+        max_concurrency = ::std::max(1u, ::std::thread::hardware_concurrency());
+    }
+    fprintf(stdout, "sizeof(GraphData)=%zu sizeof(GraphVertex)=%zu width=%zu instance_bytes=%zu\n",
+        sizeof(GraphData), sizeof(GraphVertex), FLAGS_width, instance_bytes(FLAGS_width));
+    // 依次测试2的幂个worker，非2的幂时补测一次最大值
+    ::std::vector<size_t> concurrencies;
+    for (size_t concurrency = 1; concurrency <= max_concurrency; concurrency <<= 1) {
+        concurrencies.emplace_back(concurrency);
+    }
+    if (concurrencies.back() != max_concurrency) {
+        concurrencies.emplace_back(max_concurrency);
+    }
+    double base_qps = 0;
+    for (auto concurrency : concurrencies) {
+        auto qps = run_case(concurrency);
+        if (concurrency == 1) {
+            base_qps = qps;
+        }
+        fprintf(stdout, "workers=%-4zu qps=%-10.1f speedup=%.2f\n",
+            concurrency, qps, qps / ::std::max(base_qps, 1.0));
+    }
+    return 0;
+}
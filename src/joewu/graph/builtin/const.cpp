@@ -5,19 +5,28 @@ namespace feed {
 namespace graph {
 namespace builtin {
 
+namespace {
+// setup时解析好的输出句柄，process时不再经过builder查找
+struct Context {
+    EmitHandle target;
+};
+}
+
 int32_t ConstProcessor::setup(GraphVertex& vertex) const noexcept {
     if (vertex.anonymous_emit_size() != 1) {
         LOG(WARNING) << "emit num[" << vertex.anonymous_emit_size()
             << "] != 1 for " << vertex;
         return -1;
     }
+    vertex.context<Context>()->target = vertex.anonymous_emit_handle(0);
     vertex.trivial();
     return 0;
 }
 
 int32_t ConstProcessor::process(GraphVertex& vertex) noexcept {
     auto option = vertex.option<Any>();
-    vertex.anonymous_emit(0)->emit<Any>()->ref(*option);
+    auto context = vertex.context<Context>();
+    vertex.emit(context->target)->emit<Any>()->ref(*option);
     return 0;
 }
 
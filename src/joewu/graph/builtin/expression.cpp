@@ -393,6 +393,9 @@ __BABYLON_DEFINE_BINARY_OPERATOR(Or, ||, 0);
 // 每个实例需要有不同的中间数据，存在context中
 struct Context {
     ::std::vector<Any> variables;
+    // setup时解析好的依赖和输出句柄，process时不再经过builder查找
+    ::std::vector<DependencyHandle<Any>> dependencies;
+    EmitHandle result;
 };
 
 // 节点配置数据
@@ -704,6 +707,11 @@ int32_t ExpressionProcessor::setup(GraphVertex& vertex) const noexcept {
             << "] != 1 for " << vertex;
         return -1;
     }
+    context->dependencies.clear();
+    for (size_t i = 0; i < vertex.anonymous_dependency_size(); ++i) {
+        context->dependencies.emplace_back(vertex.anonymous_dependency_handle(i));
+    }
+    context->result = vertex.anonymous_emit_handle(0);
     // 标记非并发执行
     vertex.trivial();
     return 0;
@@ -713,11 +721,11 @@ int32_t ExpressionProcessor::process(GraphVertex& vertex) noexcept {
     auto option = vertex.option<expression::Option>();
     auto context = vertex.context<expression::Context>();
     // 获取依赖，并填充初始变量
-    for (size_t i = 0; i < vertex.anonymous_dependency_size(); ++i) {
+    for (size_t i = 0; i < context->dependencies.size(); ++i) {
         auto index = option->variable_index_for_dependency[i];
-        auto dependency_value = vertex.anonymous_dependency(i)->value<Any>();
+        auto dependency_value = vertex.value(context->dependencies[i]);
         if (unlikely(dependency_value == nullptr)) {
-            if (vertex.anonymous_dependency(i)->ready()) {
+            if (vertex.dependency(context->dependencies[i])->ready()) {
                 LOG(WARNING) << "dependency[" << i << "] empty for " << vertex;
             } else {
                 LOG(WARNING) << "dependency[" << i << "] not ready for " << vertex;
@@ -734,7 +742,7 @@ int32_t ExpressionProcessor::process(GraphVertex& vertex) noexcept {
         }
     }
     // 输出目标变量
-    *vertex.anonymous_emit(0)->emit<Any>() = context->variables[option->variable_index_for_emit];
+    *vertex.emit(context->result)->emit<Any>() = context->variables[option->variable_index_for_emit];
     return 0;
 }
 
@@ -5,6 +5,23 @@ namespace feed {
 namespace graph {
 namespace builtin {
 
+namespace {
+// setup时解析好的依赖和输出句柄，process时不再经过builder查找
+struct Context {
+    ::std::vector<DependencyHandle<bool>> sources;
+    EmitHandle target;
+};
+
+void resolve_handles(GraphVertex& vertex) noexcept {
+    auto context = vertex.context<Context>();
+    context->sources.clear();
+    for (size_t i = 0; i < vertex.anonymous_dependency_size(); ++i) {
+        context->sources.emplace_back(vertex.anonymous_dependency_handle<bool>(i));
+    }
+    context->target = vertex.anonymous_emit_handle(0);
+}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // AndProcessor begin
 int32_t AndProcessor::setup(GraphVertex& vertex) const noexcept {
@@ -18,15 +35,17 @@ int32_t AndProcessor::setup(GraphVertex& vertex) const noexcept {
             << "] != 1 for " << vertex;
         return -1;
     }
+    resolve_handles(vertex);
     vertex.trivial();
     return 0;
 }
 
 int32_t AndProcessor::process(GraphVertex& vertex) noexcept {
-    auto committer = vertex.anonymous_emit(0)->emit<bool>();
+    auto context = vertex.context<Context>();
+    auto committer = vertex.emit(context->target)->emit<bool>();
     auto& value = *committer = true;
-    for (size_t i = 0; i < vertex.anonymous_dependency_size(); ++i) {
-        auto dependency_value = vertex.anonymous_dependency(i)->value<bool>();
+    for (size_t i = 0; i < context->sources.size(); ++i) {
+        auto dependency_value = vertex.value(context->sources[i]);
         if (unlikely(dependency_value == nullptr)) {
             LOG(WARNING) << "dependency[" << i << "] not ready";
             committer.cancel();
@@ -61,15 +80,17 @@ int32_t OrProcessor::setup(GraphVertex& vertex) const noexcept {
             << "] != 1 for " << vertex;
         return -1;
     }
+    resolve_handles(vertex);
     vertex.trivial();
     return 0;
 }
 
 int32_t OrProcessor::process(GraphVertex& vertex) noexcept {
-    auto committer = vertex.anonymous_emit(0)->emit<bool>();
+    auto context = vertex.context<Context>();
+    auto committer = vertex.emit(context->target)->emit<bool>();
     auto& value = *committer = false;
-    for (size_t i = 0; i < vertex.anonymous_dependency_size(); ++i) {
-        auto dependency_value = vertex.anonymous_dependency(i)->value<bool>();
+    for (size_t i = 0; i < context->sources.size(); ++i) {
+        auto dependency_value = vertex.value(context->sources[i]);
         if (unlikely(dependency_value == nullptr)) {
             LOG(WARNING) << "dependency[" << i << "] not ready";
             committer.cancel();
@@ -104,17 +125,19 @@ int32_t NotProcessor::setup(GraphVertex& vertex) const noexcept {
             << "] != 1 for " << vertex;
         return -1;
     }
+    resolve_handles(vertex);
     vertex.trivial();
     return 0;
 }
 
 int32_t NotProcessor::process(GraphVertex& vertex) noexcept {
-    auto source = vertex.anonymous_dependency(0)->value<bool>();
+    auto context = vertex.context<Context>();
+    auto source = vertex.value(context->sources[0]);
     if (unlikely(source == nullptr)) {
         LOG(WARNING) << "dependency[0] not ready";
         return -1;
     }
-    *vertex.anonymous_emit(0)->emit<bool>() = !*source;
+    *vertex.emit(context->target)->emit<bool>() = !*source;
     return 0;
 }
 
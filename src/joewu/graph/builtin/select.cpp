@@ -5,6 +5,14 @@ namespace feed {
 namespace graph {
 namespace builtin {
 
+namespace {
+// setup时解析好的依赖和输出句柄，process时不再经过builder查找
+struct Context {
+    ::std::vector<DependencyHandle<Any>> sources;
+    EmitHandle target;
+};
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // SelectProcessor begin
 std::atomic<size_t> SelectProcessor::_g_idx;
@@ -15,6 +23,12 @@ int32_t SelectProcessor::setup(GraphVertex& vertex) const noexcept {
             << "] != 1 for " << vertex;
         return -1;
     }
+    auto context = vertex.context<Context>();
+    context->sources.clear();
+    for (size_t i = 0; i < vertex.anonymous_dependency_size(); ++i) {
+        context->sources.emplace_back(vertex.anonymous_dependency_handle(i));
+    }
+    context->target = vertex.anonymous_emit_handle(0);
     vertex.trivial();
     return 0;
 }
@@ -23,19 +37,21 @@ int32_t SelectProcessor::on_activate(GraphVertex& vertex) const noexcept {
     // 如果传递可变性，则按照0号输出的可变性，设置所有依赖的可变性
     auto option = vertex.option<Option>();
     if (option == nullptr || option->forward_mutable_declaration) {
-        bool need_mutable = vertex.anonymous_emit(0)->need_mutable();
-        for (size_t i = 0; i < vertex.anonymous_dependency_size(); ++i) {
-            vertex.anonymous_dependency(i)->declare_mutable(need_mutable);
+        auto context = vertex.context<Context>();
+        bool need_mutable = vertex.emit(context->target)->need_mutable();
+        for (auto& source : context->sources) {
+            vertex.dependency(source)->declare_mutable(need_mutable);
         }
     }
     return 0;
 }
 
 int32_t SelectProcessor::process(GraphVertex& vertex) noexcept {
-    for (size_t i = 0; i < vertex.anonymous_dependency_size(); ++i) {
-        auto dependency = vertex.anonymous_dependency(i);
+    auto context = vertex.context<Context>();
+    for (size_t i = 0; i < context->sources.size(); ++i) {
+        auto dependency = vertex.dependency(context->sources[i]);
         if (dependency->ready()) {
-            if (vertex.anonymous_emit(0)->forward(*dependency)) {
+            if (vertex.emit(context->target)->forward(*dependency)) {
                 return 0;
             } else {
                 LOG(WARNING) << "forward dependency[" << i << "] failed";
@@ -0,0 +1,61 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_ALIGNED_H
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_ALIGNED_H
+
+#include <cstddef>
+#include <vector>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+// 包含alignas(64)成员的类型，在堆上分配时依赖C++17的aligned new（gcc中-faligned-new）
+// gcc482 -std=c++11下operator new只保证16字节对齐，缓存行隔离的布局会失效
+// 这类类型在堆上分配时统一经过这里，按alignof(T)申请内存，不依赖编译选项
+
+// 按alignof(T)分配的分配器，供容器使用
+template <typename T>
+class AlignedAllocator {
+public:
+    typedef T value_type;
+    template <typename U>
+    struct rebind {
+        typedef AlignedAllocator<U> other;
+    };
+
+    inline AlignedAllocator() noexcept = default;
+    template <typename U>
+    inline AlignedAllocator(const AlignedAllocator<U>&) noexcept;
+
+    inline T* allocate(size_t n);
+    inline void deallocate(T* ptr, size_t) noexcept;
+    // 元素的构造函数可以是私有的，只需要对分配器开放
+    template <typename U, typename... Args>
+    inline void construct(U* ptr, Args&&... args);
+    template <typename U>
+    inline void destroy(U* ptr) noexcept;
+};
+
+template <typename T, typename U>
+inline bool operator==(const AlignedAllocator<T>&, const AlignedAllocator<U>&) noexcept;
+template <typename T, typename U>
+inline bool operator!=(const AlignedAllocator<T>&, const AlignedAllocator<U>&) noexcept;
+
+// 按缓存行对齐的元素组成的vector
+template <typename T>
+using AlignedVector = ::std::vector<T, AlignedAllocator<T>>;
+
+// 继承后通过new创建的T按alignof(T)分配
+template <typename T>
+class AlignedNew {
+public:
+    inline static void* operator new(size_t size);
+    inline static void operator delete(void* ptr) noexcept;
+};
+
+}  // graph
+}  // feed
+}  // joewu
+
+#endif // joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_ALIGNED_H
+
+#include <joewu/graph/engine/aligned.hpp>
@@ -0,0 +1,83 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_ALIGNED_HPP
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_ALIGNED_HPP
+
+#include <joewu/graph/engine/aligned.h>
+
+#include <new>
+#include <utility>
+#include <stdlib.h>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+// posix_memalign要求对齐至少为指针大小
+inline void* aligned_allocate(size_t alignment, size_t size) {
+    void* ptr = nullptr;
+    if (alignment < sizeof(void*)) {
+        alignment = sizeof(void*);
+    }
+    if (0 != ::posix_memalign(&ptr, alignment, size)) {
+        throw ::std::bad_alloc();
+    }
+    return ptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AlignedAllocator begin
+template <typename T>
+template <typename U>
+AlignedAllocator<T>::AlignedAllocator(const AlignedAllocator<U>&) noexcept {}
+
+template <typename T>
+T* AlignedAllocator<T>::allocate(size_t n) {
+    return static_cast<T*>(aligned_allocate(alignof(T), n * sizeof(T)));
+}
+
+template <typename T>
+void AlignedAllocator<T>::deallocate(T* ptr, size_t) noexcept {
+    ::free(ptr);
+}
+
+template <typename T>
+template <typename U, typename... Args>
+void AlignedAllocator<T>::construct(U* ptr, Args&&... args) {
+    new (ptr) U(::std::forward<Args>(args)...);
+}
+
+template <typename T>
+template <typename U>
+void AlignedAllocator<T>::destroy(U* ptr) noexcept {
+    ptr->~U();
+}
+
+template <typename T, typename U>
+bool operator==(const AlignedAllocator<T>&, const AlignedAllocator<U>&) noexcept {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const AlignedAllocator<T>&, const AlignedAllocator<U>&) noexcept {
+    return false;
+}
+// AlignedAllocator end
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// AlignedNew begin
+template <typename T>
+void* AlignedNew<T>::operator new(size_t size) {
+    return aligned_allocate(alignof(T), size);
+}
+
+template <typename T>
+void AlignedNew<T>::operator delete(void* ptr) noexcept {
+    ::free(ptr);
+}
+// AlignedNew end
+///////////////////////////////////////////////////////////////////////////////
+
+} // graph
+} // feed
+} // joewu
+#endif //joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_ALIGNED_HPP
@@ -0,0 +1,144 @@
+#include <joewu/graph/engine/batch_processor.h>
+
+#include <algorithm>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+////////////////////////////////////////////////////////////////////////////////
+// BatchGraphProcessor begin
+BatchGraphProcessor::BatchGraphProcessor(size_t max_batch_size,
+    ::std::chrono::microseconds max_delay) noexcept :
+    _max_batch_size(::std::max<size_t>(max_batch_size, 1)), _max_delay(max_delay) {
+    ::std::lock_guard<::std::mutex> lock(_mutex);
+    take_pending();
+}
+
+BatchGraphProcessor::~BatchGraphProcessor() noexcept {
+    {
+        ::std::lock_guard<::std::mutex> lock(_mutex);
+        if (unlikely(!_pending->vertexes.empty())) {
+            LOG(WARNING) << "batch processor[" << this << "] destroyed with "
+                << _pending->vertexes.size() << " pending vertexes";
+        }
+        _flush_stopped = true;
+    }
+    _cond.notify_all();
+    if (_flush_thread.joinable()) {
+        _flush_thread.join();
+    }
+}
+
+void BatchGraphProcessor::process(GraphVertex& vertex,
+    GraphVertexClosure&& closure) noexcept {
+    Batch* batch = nullptr;
+    bool need_notify = false;
+    {
+        ::std::lock_guard<::std::mutex> lock(_mutex);
+        _pending->vertexes.emplace_back(&vertex);
+        _pending->closures.emplace_back(::std::move(closure));
+        if (_pending->vertexes.size() >= _max_batch_size) {
+            batch = take_pending();
+        } else if (_pending->vertexes.size() == 1) {
+            // 开启新的批次时通知后台线程按超时时间等待
+            _first_pending_time = ::std::chrono::steady_clock::now();
+            need_notify = true;
+            if (unlikely(!_flush_started)) {
+                _flush_started = true;
+                _flush_thread = ::std::thread([this] {
+                    flush_loop();
+                });
+            }
+        }
+    }
+    if (need_notify) {
+        _cond.notify_one();
+    }
+    if (batch != nullptr) {
+        run_batch(batch);
+    }
+}
+
+BatchGraphProcessor::Batch* BatchGraphProcessor::take_pending() noexcept {
+    auto batch = _pending.release();
+    if (!_free_batches.empty()) {
+        _pending = ::std::move(_free_batches.back());
+        _free_batches.pop_back();
+    } else {
+        _pending.reset(new Batch);
+        _pending->vertexes.reserve(_max_batch_size);
+        _pending->closures.reserve(_max_batch_size);
+    }
+    return batch;
+}
+
+void BatchGraphProcessor::run_batch(Batch* batch) noexcept {
+    auto size = batch->vertexes.size();
+    LOG(TRACE) << "batch processor[" << this << "] process " << size
+        << " vertexes from " << *batch->vertexes[0];
+    _batch_num.fetch_add(1, ::std::memory_order_relaxed);
+    _batched_vertex_num.fetch_add(size, ::std::memory_order_relaxed);
+    // 这一批来自不同的graph，当前线程不再代表其中任何一个vertex
+    // 期间的发布都走异步路径，不会把其他graph的后继作为续体运行
+    auto& running_vertex = GraphVertex::running_vertex();
+    auto previous_vertex = running_vertex;
+    running_vertex = nullptr;
+    int32_t ret = process_batch(&batch->vertexes[0], size);
+    running_vertex = previous_vertex;
+    if (unlikely(ret != 0)) {
+        LOG(WARNING) << "batch processor[" << this << "] process " << size
+            << " vertexes failed with " << ret;
+    }
+    // 结束后各个graph可能已经被销毁，不能再访问vertex
+    // 最后一个闭包在回收批次后再结束，之后不再访问this
+    for (size_t i = 0; i + 1 < size; ++i) {
+        batch->closures[i].done(ret);
+    }
+    GraphVertexClosure last(::std::move(batch->closures[size - 1]));
+    batch->vertexes.clear();
+    batch->closures.clear();
+    {
+        ::std::lock_guard<::std::mutex> lock(_mutex);
+        _free_batches.emplace_back(batch);
+    }
+    last.done(ret);
+}
+
+void BatchGraphProcessor::flush_loop() noexcept {
+    while (true) {
+        Batch* batch = nullptr;
+        {
+            ::std::unique_lock<::std::mutex> lock(_mutex);
+            while (true) {
+                if (_pending->vertexes.empty()) {
+                    if (_flush_stopped) {
+                        return;
+                    }
+                    _cond.wait(lock);
+                    continue;
+                }
+                // 期间批次可能已经被攒满处理，每次醒来按当前批次的时间重新判断
+                auto deadline = _first_pending_time + _max_delay;
+                if (_flush_stopped || ::std::chrono::steady_clock::now() >= deadline) {
+                    break;
+                }
+                _cond.wait_until(lock, deadline);
+            }
+            batch = take_pending();
+        }
+        // 交给vertex所在的executor处理，后台线程只负责计时
+        auto executor = batch->vertexes[0]->_executor;
+        if (0 != executor->run([this, batch] {
+                    run_batch(batch);
+                })) {
+            run_batch(batch);
+        }
+    }
+}
+// BatchGraphProcessor end
+////////////////////////////////////////////////////////////////////////////////
+
+} // graph
+} // feed
+} // joewu
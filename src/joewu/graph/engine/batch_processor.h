@@ -0,0 +1,77 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_BATCH_PROCESSOR_H
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_BATCH_PROCESSOR_H
+
+#include <joewu/graph/engine/expect.h>
+#include <joewu/graph/engine/vertex.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+// 支持攒批的算子，典型如模型打分等按批计算更高效的节点
+// 同一个实例被多个并发运行的Graph共享时，各个实例中的vertex合并为一次process_batch调用
+// 攒满max_batch_size时在提交最后一个vertex的线程上直接处理
+// 最早的vertex等待超过max_delay时由后台线程交给这批vertex所在的executor处理
+// executor不支持运行普通函数时，退回由后台线程直接处理
+// 需要通过实例而非名字设置到GraphVertexBuilder，才能在build出的所有Graph间共享
+// 实例需要比使用它的所有Graph运行存活更久
+class BatchGraphProcessor : public GraphProcessor {
+public:
+    BatchGraphProcessor(size_t max_batch_size = 64,
+        ::std::chrono::microseconds max_delay = ::std::chrono::microseconds(1000)) noexcept;
+    virtual ~BatchGraphProcessor() noexcept;
+
+    // 已经处理的批次数和vertex数
+    inline size_t batch_num() const noexcept;
+    inline size_t batched_vertex_num() const noexcept;
+
+protected:
+    // 处理一批来自不同Graph实例的vertex，分别读取各自的依赖并发布到各自的emits
+    // 返回非0时这一批中的全部vertex以此结束
+    virtual int32_t process_batch(GraphVertex* vertexes[], size_t size) noexcept = 0;
+
+private:
+    // 一个批次，处理结束后回收复用，稳态下攒批不产生内存分配
+    struct Batch {
+        ::std::vector<GraphVertex*> vertexes;
+        ::std::vector<GraphVertexClosure> closures;
+    };
+
+    // 加入待处理批次，攒满时直接处理
+    virtual void process(GraphVertex& vertex, GraphVertexClosure&& closure) noexcept override final;
+    // 【持有_mutex】取出当前批次，并换上一个空批次
+    Batch* take_pending() noexcept;
+    // 处理一批并结束其中每个vertex的闭包，之后回收批次
+    void run_batch(Batch* batch) noexcept;
+    // 后台线程，将等待超时的批次交给executor处理
+    void flush_loop() noexcept;
+
+    size_t _max_batch_size;
+    ::std::chrono::microseconds _max_delay;
+    ::std::mutex _mutex;
+    ::std::condition_variable _cond;
+    ::std::unique_ptr<Batch> _pending;
+    ::std::vector<::std::unique_ptr<Batch>> _free_batches;
+    // 当前批次中最早的vertex加入的时间
+    ::std::chrono::steady_clock::time_point _first_pending_time;
+    ::std::thread _flush_thread;
+    bool _flush_started {false};
+    bool _flush_stopped {false};
+    ::std::atomic<size_t> _batch_num {0};
+    ::std::atomic<size_t> _batched_vertex_num {0};
+};
+
+} // graph
+} // feed
+} // joewu
+#endif //joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_BATCH_PROCESSOR_H
+
+#include <joewu/graph/engine/batch_processor.hpp>
@@ -0,0 +1,25 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_BATCH_PROCESSOR_HPP
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_BATCH_PROCESSOR_HPP
+
+#include <joewu/graph/engine/batch_processor.h>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+///////////////////////////////////////////////////////////////////////////////
+// BatchGraphProcessor begin
+size_t BatchGraphProcessor::batch_num() const noexcept {
+    return _batch_num.load(::std::memory_order_relaxed);
+}
+
+size_t BatchGraphProcessor::batched_vertex_num() const noexcept {
+    return _batched_vertex_num.load(::std::memory_order_relaxed);
+}
+// BatchGraphProcessor end
+///////////////////////////////////////////////////////////////////////////////
+
+} // graph
+} // feed
+} // joewu
+#endif //joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_BATCH_PROCESSOR_HPP
@@ -1,8 +1,12 @@
 #include <joewu/graph/engine/builder.h>
 #include <joewu/graph/engine/graph.h>
+#include <joewu/graph/engine/graph_plan.h>
 #include <joewu/graph/engine/data.h>
 #include <joewu/graph/engine/vertex.h>
 
+#include <algorithm>
+#include <functional>
+
 namespace joewu {
 namespace feed {
 namespace graph {
@@ -23,6 +27,7 @@ int32_t GraphBuilder::finish() noexcept {
     LOG(TRACE) << "analyzing " << *this;
     _producer_by_data_index.clear();
     _data_index_by_name.clear();
+    _plan.reset();
     for (auto& vertex : _vertexes) {
         if (unlikely(0 != vertex.finish(_data_index_by_name, _producer_by_data_index))) {
             LOG(WARNING) << "finish " << vertex << " failed";
@@ -30,16 +35,98 @@ int32_t GraphBuilder::finish() noexcept {
         }
         LOG(NOTICE) << "add " << vertex;
     }
+    calculate_priority();
+    compile_plan();
     LOG(NOTICE) << "finish analyze " << this << " with "
         << _vertexes.size() << " vertexes and "
         << _data_index_by_name.size() << " data";
     return 0;
 }
 
+void GraphBuilder::calculate_priority() noexcept {
+    // 按data记录消费它的节点，条件依赖也算作消费
+    ::std::vector<::std::vector<GraphVertexBuilder*>> consumers_by_data_index(
+        _data_index_by_name.size());
+    ::std::vector<GraphVertexBuilder*> vertexes;
+    vertexes.reserve(_vertexes.size());
+    for (auto& vertex : _vertexes) {
+        vertexes.emplace_back(&vertex);
+        auto add_consumer = [&] (const GraphDependencyBuilder& dependency) {
+            consumers_by_data_index[dependency._target_index].emplace_back(&vertex);
+            if (!dependency._condition.empty()) {
+                consumers_by_data_index[dependency._condition_index].emplace_back(&vertex);
+            }
+        };
+        for (auto& dependency : vertex._named_dependencies) {
+            add_consumer(dependency);
+        }
+        for (auto& dependency : vertex._anonymous_dependencies) {
+            add_consumer(dependency);
+        }
+    }
+
+    // 0: 未计算 1: 计算中 2: 已完成
+    ::std::vector<uint8_t> states(vertexes.size(), 0);
+    ::std::function<uint64_t(GraphVertexBuilder&)> calculate =
+        [&] (GraphVertexBuilder& vertex) -> uint64_t {
+        auto& state = states[vertex.index()];
+        if (state == 2) {
+            return vertex._priority;
+        } else if (state == 1) {
+            // 成环时忽略这条边，不影响正确性，只是优先级不再精确
+            LOG(WARNING) << "cycle detected at " << vertex << " when calculate priority";
+            return 0;
+        }
+        state = 1;
+        uint64_t max_successor_priority = 0;
+        auto visit_emit = [&] (const GraphEmitBuilder& emit) {
+            for (auto consumer : consumers_by_data_index[emit.target_index()]) {
+                max_successor_priority = ::std::max(max_successor_priority,
+                    calculate(*consumer));
+            }
+        };
+        for (auto& emit : vertex._named_emits) {
+            visit_emit(emit);
+        }
+        for (auto& emit : vertex._anonymous_emits) {
+            visit_emit(emit);
+        }
+        vertex._priority = vertex._estimated_cost + max_successor_priority;
+        state = 2;
+        return vertex._priority;
+    };
+    for (auto vertex : vertexes) {
+        calculate(*vertex);
+    }
+}
+
+void GraphBuilder::compile_plan() noexcept {
+    ::std::vector<size_t> successor_num_by_data_index(_data_index_by_name.size(), 0);
+    auto count_successor = [&] (const GraphDependencyBuilder& dependency) {
+        ++successor_num_by_data_index[dependency._target_index];
+        if (!dependency._condition.empty()) {
+            ++successor_num_by_data_index[dependency._condition_index];
+        }
+    };
+    for (auto& vertex : _vertexes) {
+        for (auto& dependency : vertex._named_dependencies) {
+            count_successor(dependency);
+        }
+        for (auto& dependency : vertex._anonymous_dependencies) {
+            count_successor(dependency);
+        }
+    }
+    _plan.reset(new GraphPlan(_vertexes.size(), _data_index_by_name,
+        ::std::move(successor_num_by_data_index)));
+}
+
 ::std::unique_ptr<Graph> GraphBuilder::build() const noexcept {
     LOG(TRACE) << "building " << *this;
-    ::std::unique_ptr<Graph> graph(
-        new Graph(*_executor, _vertexes.size(), _data_index_by_name));
+    if (unlikely(_plan == nullptr)) {
+        LOG(WARNING) << "build " << *this << " before finish";
+        return ::std::unique_ptr<Graph>();
+    }
+    ::std::unique_ptr<Graph> graph(new Graph(*_executor, _plan));
     auto& vertexes = graph->vertexes();
     size_t i = 0;
     for (auto& builder : _vertexes) {
@@ -50,6 +137,11 @@ int32_t GraphBuilder::finish() noexcept {
         }
         ++i;
     }
+    // 必要依赖和可变依赖可能在setup中声明，需要全部节点build完成后再分析
+    for (auto& vertex : vertexes) {
+        vertex.analyze_sheddable();
+        vertex.analyze_memo();
+    }
     for (const auto& one_data : graph->data()) {
         if (unlikely(0 != one_data.error_code())) {
             LOG(WARNING) << one_data << " build failed";
@@ -59,6 +151,15 @@ int32_t GraphBuilder::finish() noexcept {
     return graph;
 }
 
+DataHandle GraphBuilder::data_handle(const ::std::string& name) const noexcept {
+    size_t index = 0;
+    if (unlikely(_plan == nullptr || !_plan->data_index(name, index))) {
+        LOG(WARNING) << "no data named " << name << " in " << *this;
+        return DataHandle();
+    }
+    return DataHandle(index);
+}
+
 int32_t GraphVertexBuilder::finish(
     ::std::unordered_map<::std::string, size_t>& data_index_by_name,
     ::std::unordered_map<size_t, const GraphVertexBuilder*>& producer_by_data_index) noexcept {
@@ -93,6 +194,17 @@ int32_t GraphVertexBuilder::finish(
             return -1;
         }
     }
+    if (_builder->auto_trivial() > 0) {
+        _cost.reset(new GraphVertexCost(_builder->auto_trivial()));
+    } else {
+        _cost.reset();
+    }
+    if (_memo_capacity > 0) {
+        _memo.reset(new GraphVertexMemo(_memo_capacity, _memo_ttl,
+                    _memo_hasher, _memo_equal));
+    } else {
+        _memo.reset();
+    }
     if (_processor != nullptr) {
         auto* processor = _processor;
         _processor_creator = [processor] {
@@ -114,10 +226,14 @@ int32_t GraphVertexBuilder::finish(
 
 
 int32_t GraphVertexBuilder::build(GraphExecutor& executor,
-    GraphVertex& vertex, ::std::vector<GraphData>& data) const noexcept {
+    GraphVertex& vertex, AlignedVector<GraphData>& data) const noexcept {
     LOG(TRACE) << "building vertex[" << _index << "]";
     vertex.builder(*this);
-    vertex.executor(executor);
+    vertex.executor(_executor != nullptr ? *_executor : executor);
+    vertex.continuation(_builder->continuation());
+    vertex.priority(_priority);
+    vertex.cost(_cost.get());
+    vertex.memo(_memo.get());
     vertex.index(_index);
     auto processor = _processor_creator();
     if (!processor) {
@@ -185,7 +301,7 @@ int32_t GraphDependencyBuilder::finish(
 }
 
 void GraphDependencyBuilder::build(GraphDependency& dependency, GraphVertex& vertex,
-    ::std::vector<GraphData>& data) const noexcept {
+    AlignedVector<GraphData>& data) const noexcept {
     LOG(TRACE) << "building dependency vertex[" << _source->index()
         << "] to data[" << _target_index << "]"
         << (_condition.empty() ? "" : " on data[")
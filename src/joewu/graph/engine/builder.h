@@ -2,6 +2,8 @@
 #define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_BUILDER_H   
 
 #include <joewu/graph/engine/on_emit.h>
+#include <joewu/graph/engine/handle.h>
+#include <joewu/graph/engine/memo.h>
 
 #include <joewu/feed/mlarch/babylon/any.h>
 #include <joewu/feed/mlarch/babylon/application_context.h>
@@ -19,6 +21,7 @@ using ::joewu::feed::mlarch::babylon::Any;
 using ::joewu::feed::mlarch::babylon::ApplicationContext;
 
 class Graph;
+class GraphPlan;
 class GraphExecutor;
 class GraphProcessor;
 class GraphVertexBuilder;
@@ -34,6 +37,15 @@ public:
     inline ApplicationContext& application_context() const noexcept;
     // 设置executor，用于支持实际图运行
     inline GraphBuilder& executor(GraphExecutor& executor) noexcept;
+    // 开启续体执行，节点运行中产出的可运行后继节点，最后一个直接在当前线程运行
+    // 省去一次executor调度，max_depth限制连续内联运行的深度，为0时关闭
+    inline GraphBuilder& continuation(size_t max_depth = 32) noexcept;
+    inline size_t continuation() const noexcept;
+    // 开启自动平凡判定，统计每个节点在最近一个窗口内process耗时的p90
+    // 低于threshold_ns的节点直接在当前线程运行，省去一次executor调度
+    // 变慢后再自动退回executor调度，为0时关闭，手动标记的平凡节点不受影响
+    inline GraphBuilder& auto_trivial(uint64_t threshold_ns = 5000) noexcept;
+    inline uint64_t auto_trivial() const noexcept;
     // 加入一个processor，返回GraphVertexBuilder进行进一步依赖设置
     // processor支持直接设置实例或者使用名字从context中组装实例
     inline GraphVertexBuilder& add_vertex(GraphProcessor& processor) noexcept;
@@ -43,23 +55,38 @@ public:
     inline const ::std::list<GraphVertexBuilder>& vertexes() const noexcept;
     // 完成构建，检测整体正确性
     // 并将各个builder的string描述转为序号加速
+    // 同时编译出所有实例共享的GraphPlan
     int32_t finish() noexcept;
     // 之后可以反复通过build获取Graph实例
     ::std::unique_ptr<Graph> build() const noexcept;
+    // finish后将data名字解析为句柄，可用于所有build出的Graph实例
+    // 不存在时返回无效句柄
+    DataHandle data_handle(const ::std::string& name) const noexcept;
 
 private:
+    // 计算每个节点到图末端的最长路径代价作为调度优先级
+    // 关键路径上的节点优先级更高
+    void calculate_priority() noexcept;
+    // 根据符号表和依赖关系编译GraphPlan
+    void compile_plan() noexcept;
+
     // 描述
     ::std::string _name;
     GraphExecutor* _executor;
+    size_t _continuation {0};
+    uint64_t _auto_trivial {0};
     ::std::list<GraphVertexBuilder> _vertexes;
     ApplicationContext* _application_context = &ApplicationContext::instance();
     // 符号表
     ::std::unordered_map<::std::string, size_t> _data_index_by_name;
     ::std::unordered_map<size_t, const GraphVertexBuilder*> _producer_by_data_index;
+    // finish后生成，build出的Graph实例共同持有
+    ::std::shared_ptr<const GraphPlan> _plan;
 };
 
 class GraphData;
 class GraphVertex;
+class GraphVertexCost;
 class GraphDependency;
 class GraphEmitBuilder;
 class GraphDependencyBuilder;
@@ -96,13 +123,39 @@ public:
     inline GraphVertexBuilder& option(T&& option) noexcept;
     template <typename T>
     inline const T* option() const noexcept;
+    // 单独设置该节点使用的executor，覆盖GraphBuilder::executor的设置
+    // 典型如为模型推理等重计算节点或阻塞IO节点设置独立的线程池
+    // 避免一类慢节点占满共享的执行资源，拖慢其他节点
+    inline GraphVertexBuilder& executor(GraphExecutor& executor) noexcept;
+    // 设置预估运行代价，用于加权计算调度优先级，默认为1
+    // 可以用实测的算子耗时（例如微秒数）来设置
+    inline GraphVertexBuilder& estimated_cost(uint64_t cost) noexcept;
+    inline uint64_t estimated_cost() const noexcept;
+    // GraphBuilder::finish后可用，自身到图末端最长路径的代价和
+    inline uint64_t priority() const noexcept;
+    // GraphBuilder::auto_trivial开启且finish后可用，该节点跨图实例累计的耗时统计
+    inline const GraphVertexCost* cost() const noexcept;
+    // 开启跨请求的结果缓存，用于产出只由依赖的值决定的节点
+    // 以全部依赖值的hash为key，同一builder产出的Graph实例共享，命中时不再运行process
+    // 最多缓存capacity份产出，为0时关闭，ttl为0时不过期
+    // 产出需要可以复制，命中时以常量引用发布，产出被可变依赖消费时不使用缓存
+    inline GraphVertexBuilder& memo(size_t capacity,
+        ::std::chrono::nanoseconds ttl = ::std::chrono::nanoseconds(0)) noexcept;
+    // 设置依赖值的hasher，默认支持基础数值类型和::std::string
+    // 提供equal时依赖值需要可以复制，副本随条目保存，命中时比较以排除hash冲突
+    // 不提供equal时不做校验，需要hasher自身保证不同的值不会得到相同的hash
+    inline GraphVertexBuilder& memo_hasher(const GraphMemoHasher& hasher,
+        const GraphMemoEqual& equal = GraphMemoEqual()) noexcept;
+    // finish后可用，开启缓存时返回跨图实例共享的缓存
+    inline const GraphVertexMemo* memo() const noexcept;
     // 完成构建，传入data编号用于加速访问
     int32_t finish(::std::unordered_map<::std::string, size_t>& data_index_by_name,
         ::std::unordered_map<size_t, const GraphVertexBuilder*>& producer_by_data_index) noexcept;
-    // 构造一个vertex，设定executor，并根据序号绑定上下游的data
+    // 构造一个vertex，设定executor（未单独设置时使用传入的executor）
+    // 并根据序号绑定上下游的data
     // 传入data是一个全集，内部依赖finish时固化的index按需获取
     int32_t build(GraphExecutor& executor,
-        GraphVertex& vertex, ::std::vector<GraphData>& data) const noexcept;
+        GraphVertex& vertex, AlignedVector<GraphData>& data) const noexcept;
 
     inline const ::std::vector<GraphDependencyBuilder>& named_dependencies() const noexcept;
     inline const ::std::vector<GraphDependencyBuilder>& anonymous_dependencies() const noexcept;
@@ -127,6 +180,15 @@ private:
     inline GraphData* anonymous_emit(size_t index,
         ::std::vector<GraphData*>& data) const noexcept;
     inline size_t anonymous_emit_size() const noexcept;
+    // 解析依赖和输出在vertex中的实际序号，用于生成句柄
+    inline bool named_dependency_index(const ::std::string& name,
+        size_t& index) const noexcept;
+    inline bool anonymous_dependency_index(size_t anonymous_index,
+        size_t& index) const noexcept;
+    inline bool named_emit_index(const ::std::string& name,
+        size_t& index) const noexcept;
+    inline bool anonymous_emit_index(size_t anonymous_index,
+        size_t& index) const noexcept;
 
     // 描述
     const GraphBuilder* const _builder;
@@ -135,6 +197,15 @@ private:
 	::std::string _processor_name; 
     GraphProcessor* _processor = nullptr;
     Any _option;
+    GraphExecutor* _executor {nullptr};
+    uint64_t _estimated_cost {1};
+    uint64_t _priority {0};
+    ::std::unique_ptr<GraphVertexCost> _cost;
+    size_t _memo_capacity {0};
+    ::std::chrono::nanoseconds _memo_ttl {0};
+    GraphMemoHasher _memo_hasher;
+    GraphMemoEqual _memo_equal;
+    ::std::unique_ptr<GraphVertexMemo> _memo;
     
     ::std::function<ScopedComponent<GraphProcessor>()> _processor_creator;
     ::std::unordered_map<::std::string, size_t> _dependency_index_by_name;
@@ -217,7 +288,7 @@ public:
     // 构造一个dependency，设定所属vertex，并根据序号绑定data
     // 传入data是一个全集，内部依赖finish时固化的index按需获取
     void build(GraphDependency& dependency, GraphVertex& vertex,
-        ::std::vector<GraphData>& data) const noexcept;
+        AlignedVector<GraphData>& data) const noexcept;
 
     inline const ::std::string& name() const noexcept;
     inline size_t index() const noexcept;
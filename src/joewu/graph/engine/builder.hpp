@@ -35,6 +35,24 @@ inline GraphBuilder& GraphBuilder::executor(GraphExecutor& executor) noexcept {
     return *this;
 }
 
+inline GraphBuilder& GraphBuilder::continuation(size_t max_depth) noexcept {
+    _continuation = max_depth;
+    return *this;
+}
+
+inline size_t GraphBuilder::continuation() const noexcept {
+    return _continuation;
+}
+
+inline GraphBuilder& GraphBuilder::auto_trivial(uint64_t threshold_ns) noexcept {
+    _auto_trivial = threshold_ns;
+    return *this;
+}
+
+inline uint64_t GraphBuilder::auto_trivial() const noexcept {
+    return _auto_trivial;
+}
+
 inline GraphVertexBuilder& GraphBuilder::add_vertex(GraphProcessor& processor) noexcept {
     _vertexes.emplace_back(*this, _vertexes.size());
     _vertexes.back().processor(processor);
@@ -151,6 +169,46 @@ const T* GraphVertexBuilder::option() const noexcept {
     return _option.get<T>();
 }
 
+inline GraphVertexBuilder& GraphVertexBuilder::executor(GraphExecutor& executor) noexcept {
+    _executor = &executor;
+    return *this;
+}
+
+inline GraphVertexBuilder& GraphVertexBuilder::estimated_cost(uint64_t cost) noexcept {
+    _estimated_cost = cost;
+    return *this;
+}
+
+inline uint64_t GraphVertexBuilder::estimated_cost() const noexcept {
+    return _estimated_cost;
+}
+
+inline uint64_t GraphVertexBuilder::priority() const noexcept {
+    return _priority;
+}
+
+inline const GraphVertexCost* GraphVertexBuilder::cost() const noexcept {
+    return _cost.get();
+}
+
+inline GraphVertexBuilder& GraphVertexBuilder::memo(size_t capacity,
+    ::std::chrono::nanoseconds ttl) noexcept {
+    _memo_capacity = capacity;
+    _memo_ttl = ttl;
+    return *this;
+}
+
+inline GraphVertexBuilder& GraphVertexBuilder::memo_hasher(
+    const GraphMemoHasher& hasher, const GraphMemoEqual& equal) noexcept {
+    _memo_hasher = hasher;
+    _memo_equal = equal;
+    return *this;
+}
+
+inline const GraphVertexMemo* GraphVertexBuilder::memo() const noexcept {
+    return _memo.get();
+}
+
 GraphDependency* GraphVertexBuilder::named_dependency(const ::std::string& name,
     ::std::vector<GraphDependency>& dependencies) const noexcept {
     auto it = _dependency_index_by_name.find(name);
@@ -195,6 +253,44 @@ size_t GraphVertexBuilder::anonymous_emit_size() const noexcept {
     return _anonymous_emits.size();
 }
 
+bool GraphVertexBuilder::named_dependency_index(const ::std::string& name,
+    size_t& index) const noexcept {
+    auto it = _dependency_index_by_name.find(name);
+    if (unlikely(it == _dependency_index_by_name.end())) {
+        return false;
+    }
+    index = it->second;
+    return true;
+}
+
+bool GraphVertexBuilder::anonymous_dependency_index(size_t anonymous_index,
+    size_t& index) const noexcept {
+    if (unlikely(anonymous_index >= _anonymous_dependencies.size())) {
+        return false;
+    }
+    index = _named_dependencies.size() + anonymous_index;
+    return true;
+}
+
+bool GraphVertexBuilder::named_emit_index(const ::std::string& name,
+    size_t& index) const noexcept {
+    auto it = _emit_index_by_name.find(name);
+    if (unlikely(it == _emit_index_by_name.end())) {
+        return false;
+    }
+    index = it->second;
+    return true;
+}
+
+bool GraphVertexBuilder::anonymous_emit_index(size_t anonymous_index,
+    size_t& index) const noexcept {
+    if (unlikely(anonymous_index >= _anonymous_emits.size())) {
+        return false;
+    }
+    index = _named_emits.size() + anonymous_index;
+    return true;
+}
+
 const ::std::vector<GraphDependencyBuilder>& GraphVertexBuilder::named_dependencies() const noexcept {
     return _named_dependencies;
 }
@@ -1,19 +1,45 @@
 #include <joewu/graph/engine/closure.h>
 #include <joewu/graph/engine/data.h>
 
+#include <algorithm>
+
 namespace joewu {
 namespace feed {
 namespace graph {
 
-ClosureContext::~ClosureContext() noexcept {
-    if (_flush_callback != nullptr) {
-        delete _flush_callback;
-    }
+ClosureContext::~ClosureContext() noexcept {}
+
+void ClosureContext::add_waiting_data(GraphData* data) noexcept {
+    data->_next_waiting_data = _waiting_data;
+    _waiting_data = data;
+}
+
+ClosureContext*& ClosureContext::inline_running_context() noexcept {
+    static thread_local ClosureContext* context = nullptr;
+    return context;
+}
+
+::timespec ClosureContext::abstime_after(int64_t timeout_us) noexcept {
+    timeout_us = ::std::max<int64_t>(timeout_us, 0);
+    ::timespec abstime;
+    ::clock_gettime(CLOCK_REALTIME, &abstime);
+    int64_t nsec = abstime.tv_nsec + (timeout_us % 1000000) * 1000;
+    abstime.tv_sec += timeout_us / 1000000 + nsec / 1000000000;
+    abstime.tv_nsec = nsec % 1000000000;
+    return abstime;
+}
+
+bool ClosureContext::passed(const ::timespec& abstime) noexcept {
+    ::timespec now;
+    ::clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec > abstime.tv_sec
+        || (now.tv_sec == abstime.tv_sec && now.tv_nsec >= abstime.tv_nsec);
 }
 
 void ClosureContext::log_unfinished_data() const noexcept {
     BABYLON_STACK(const GraphData*, unfinished_data, _all_data_num);
-    for (auto one_waiting_data : _waiting_data) {
+    for (auto one_waiting_data = _waiting_data; one_waiting_data != nullptr;
+            one_waiting_data = one_waiting_data->_next_waiting_data) {
         if (!one_waiting_data->ready()) {
             unfinished_data.emplace_back(one_waiting_data);
         }
@@ -66,6 +92,15 @@ void ClosureContext::log_unfinished_data() const noexcept {
 
 ClosureCallback* ClosureContext::SEALED_CALLBACK =
     reinterpret_cast<ClosureCallback*>(0xFFFFFFFFFFFFFFFFL);
+constexpr int32_t ClosureContext::NOT_POOLED;
+constexpr int32_t ClosureContext::POOLED_IDLE;
+constexpr int32_t ClosureContext::POOLED_IN_USE;
+constexpr int32_t ClosureContext::RELEASE_NONE;
+constexpr int32_t ClosureContext::RELEASE_PENDING;
+constexpr int32_t ClosureContext::RELEASE_FLUSHED;
+constexpr int32_t ClosureContext::FLUSH_LISTENER_NONE;
+constexpr int32_t ClosureContext::FLUSH_LISTENER_ARMED;
+constexpr int32_t ClosureContext::FLUSH_LISTENER_FLUSHED;
 
 } // graph
 } // feed
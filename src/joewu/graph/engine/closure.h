@@ -7,8 +7,12 @@
 
 #include <mutex>
 #include <atomic>
+#include <chrono>
+#include <time.h>
+#include <condition_variable>
 #include <memory>
 #include <functional>
+#include <type_traits>
 
 namespace joewu {
 namespace feed {
@@ -19,11 +23,20 @@ typedef ::std::function<void(Closure&&)> ClosureCallback;
 
 class GraphExecutor;
 class ClosureContext;
+// Closure析构时释放context，由Graph复用的context会被归还而不是销毁
+class ClosureContextDeleter {
+public:
+    inline void operator()(ClosureContext* context) const noexcept;
+};
+
 class Closure {
 public:
     // 创建一个closure
     template <typename M>
     inline static Closure create(GraphExecutor& executor) noexcept;
+    // 创建一个基于原子状态字的closure，W为等待器，参见FutexWaiter
+    template <typename W>
+    inline static Closure create_atomic(GraphExecutor& executor) noexcept;
     
     Closure() {};
     
@@ -36,27 +49,77 @@ public:
     inline int32_t get() noexcept;
     // 阻塞等待进入稳态
     inline void wait() noexcept;
+    // 最多等待timeout进入终止态，超时返回false
+    // 未超时返回true，并通过error_code返回错误码
+    template <typename R, typename P>
+    inline bool get_for(const ::std::chrono::duration<R, P>& timeout,
+        int32_t& error_code) noexcept;
+    // 最多等待timeout进入稳态，超时返回false
+    template <typename R, typename P>
+    inline bool wait_for(const ::std::chrono::duration<R, P>& timeout) noexcept;
+    // 取消本次运行，以error_code进入终止态
+    // 尚未开始的节点不再运行，直接发布空的emits，已经在运行的节点不受影响
+    // 仍需等待进入稳态后才能重用或销毁
+    inline void cancel(int32_t error_code = -1) noexcept;
     // 进入终止态后可以获得错误码
     inline int32_t error_code() const noexcept;
     // 注册callback
     // 调用后当前Closure对象不再可用
     // 等待finish之后，callback会被调用
     // 等效的Closure会被传入，用于反馈结果，以及进一步跟踪图状态
+    // 默认通过executor调度运行callback
+    // inplace为true时，在完成最后一个所需data的线程上直接运行，省去一次调度
+    // 此时callback可能运行在节点之中，需要轻量且不能在其中wait
+    // 丢弃传入的Closure不会阻塞，会在进入稳态后自动释放
     template <typename C>
-    inline void on_finish(C&& callback) noexcept;
+    inline void on_finish(C&& callback, bool inplace = false) noexcept;
 
 private:
     inline Closure(ClosureContext* context) noexcept;
     inline ClosureContext* context() noexcept;
 
-    ::std::unique_ptr<ClosureContext> _context;
+    ::std::unique_ptr<ClosureContext, ClosureContextDeleter> _context;
     
     friend class Graph;
     friend class GraphExecutor;
     friend class ClosureContext;
+    friend class ClosureGroup;
+    friend class ClosureGroupContext;
     friend class BthreadGraphExecutor;
 };
 
+// 可以由其他线程解锁的互斥量，本质是一个二值信号量
+// 满足ClosureContextImplement对M的要求，供不依赖bthread的执行器使用
+class SemaphoreMutex {
+public:
+    inline void lock() noexcept;
+    inline bool try_lock() noexcept;
+    inline void unlock() noexcept;
+
+private:
+    ::std::mutex _mutex;
+    ::std::condition_variable _cond;
+    bool _locked {false};
+};
+
+// 基于futex的等待器，只能挂起pthread，供不依赖bthread的执行器使用
+// 满足AtomicClosureContext对W的要求
+// word: 用于等待的状态字
+// wait: 状态字仍等于expected时挂起，允许虚假唤醒
+//       abstime为CLOCK_REALTIME下的绝对时间，nullptr表示不超时
+// wake_all: 唤醒全部挂起者，只通过状态字地址操作，
+// 因为被唤醒者可能已经销毁了等待器
+class FutexWaiter {
+public:
+    inline ::std::atomic<int32_t>* word() noexcept;
+    inline static void wait(::std::atomic<int32_t>* word, int32_t expected,
+        const ::timespec* abstime) noexcept;
+    inline static void wake_all(::std::atomic<int32_t>* word) noexcept;
+
+private:
+    ::std::atomic<int32_t> _word {0};
+};
+
 class GraphData;
 class GraphExecutor;
 class ClosureContext {
@@ -72,14 +135,31 @@ public:
     inline int32_t get() noexcept;
     // 阻塞等待进入稳态
     inline void wait() noexcept;
+    // 最多等待timeout_us微秒进入终止态，超时返回false
+    inline bool get_for(int64_t timeout_us, int32_t& error_code) noexcept;
+    // 最多等待timeout_us微秒进入稳态，超时返回false
+    inline bool wait_for(int64_t timeout_us) noexcept;
+    // 取消本次运行并以error_code进入终止态
+    inline void cancel(int32_t error_code) noexcept;
+    // 是否已经被取消，节点据此跳过运行
+    inline bool cancelled() const noexcept;
+    // 设置本次运行的deadline，为steady_clock下的纳秒数，0表示不限制
+    inline void deadline(int64_t deadline_ns) noexcept;
+    // 是否已经超过deadline，超过后可舍弃的节点不再运行
+    inline bool expired() const noexcept;
     // 进入终止态后可以获得错误码
     inline int32_t error_code() const noexcept;
     // 注册callback
     // 调用后当前Closure对象不再可用
     // 当finish之后，callback会被调用
     // 等效的Closure会被传入，用于反馈结果，以及进一步跟踪图状态
+    // inplace为true时在结束的线程上直接运行，不经过executor
     template <typename C>
-    inline void on_finish(C&& callback) noexcept;
+    inline void on_finish(C&& callback, bool inplace = false) noexcept;
+    // 注册进入稳态时的通知，只能注册一次，已经进入稳态时在当前线程直接通知
+    // 在进入稳态的线程上直接运行，需要轻量，通知不转移closure的所有权
+    // 用于ClosureGroup等待组内closure全部进入稳态
+    inline void on_flush(::std::function<void()>&& listener) noexcept;
     ///////////////////////////////////////////////////////////////////////////
 
     ///////////////////////////////////////////////////////////////////////////
@@ -101,33 +181,87 @@ public:
     inline void depend_vertex_add() noexcept;
     // 返回true表示需要executor异步触发回调
     inline void depend_vertex_sub() noexcept;
-    inline void add_waiting_data(GraphData* data) noexcept;
+    void add_waiting_data(GraphData* data) noexcept;
     inline void all_data_num(size_t num) noexcept;
     ///////////////////////////////////////////////////////////////////////////
 
+    ///////////////////////////////////////////////////////////////////////////
+    // 由Graph持有并在多次运行间复用，省去每次运行的创建和销毁
+    // 标记为复用，当前处于使用中
+    inline void pooled() noexcept;
+    // 空闲时取出使用，并重置为初始状态，返回false表示仍在被上一次运行的Closure使用
+    inline bool reuse() noexcept;
+    // Closure析构时调用，复用的context等待稳态后归还，否则直接销毁
+    // 在就地运行的回调中调用时，转为release_on_flush，避免在节点中等待稳态
+    inline void release() noexcept;
+    // Graph析构时调用，空闲则直接销毁，否则转为由持有的Closure销毁
+    inline void abandon() noexcept;
+    // 不等待稳态的release，已经进入稳态时立即release，否则推迟到进入稳态时
+    // 用于在回调中放弃closure，回调可能运行在尚未结束的节点中，等待会导致死锁
+    inline void release_on_flush() noexcept;
+    ///////////////////////////////////////////////////////////////////////////
+
     // 运行callback，由executer在异步环境中调用
-    // 运行结束后会销毁this和callback
+    // callback没有转移走closure时，进入稳态后会销毁this和callback
     inline void run(ClosureCallback* callback) noexcept;
+    // 暂存待运行的callback，executor调度时只需要传递this，无需额外分配参数对象
+    inline void stash(ClosureCallback* callback) noexcept;
+    // 运行暂存的callback，运行结束后会销毁this
+    inline void run_stashed() noexcept;
 
 protected:
     ///////////////////////////////////////////////////////////////////////////
-    // 使用具体mutex实现wait和notify
+    // 使用具体同步原语实现wait和notify
     virtual void wait_finish() noexcept = 0;
     virtual void notify_finish() noexcept = 0;
     virtual void wait_flush() noexcept = 0;
     virtual void notify_flush() noexcept = 0;
+    // 复用前恢复为创建时的锁定状态
+    virtual void rearm() noexcept = 0;
+    // 限时等待，abstime为CLOCK_REALTIME下的绝对时间，超时返回false
+    virtual bool wait_finish_until(const ::timespec& abstime) noexcept = 0;
+    virtual bool wait_flush_until(const ::timespec& abstime) noexcept = 0;
+    // 计算当前时间timeout_us微秒之后的绝对时间
+    static ::timespec abstime_after(int64_t timeout_us) noexcept;
+    // 绝对时间是否已经过去
+    static bool passed(const ::timespec& abstime) noexcept;
     ///////////////////////////////////////////////////////////////////////////
 
 private:
     // 使用executor执行callback
     // executor准备好执行环境后，会在异步环境调用run
     inline int32_t invoke(ClosureCallback* callback) noexcept;
+    // 执行on_finish注册的callback，标记了就地执行时直接run，否则invoke
+    inline int32_t dispatch(ClosureCallback* callback) noexcept;
+    // 当前线程正在就地运行回调的context，其间的release都不能等待稳态
+    static ClosureContext*& inline_running_context() noexcept;
+    // 实际执行release，复用的context需要已经或者可以等待进入稳态
+    inline void release_now() noexcept;
     // 标记finish，只有第一次标记成功
     // 标记成功时，如果已经注册了callback，会通过callback返回
     inline bool mark_finished(int32_t error_code, ClosureCallback*& callback) noexcept;
+    // 设置on_finish回调，可复制的回调直接存入，避免包装带来的额外分配
+    template <typename C, typename ::std::enable_if<
+        ::std::is_copy_constructible<typename ::std::decay<C>::type>::value, int32_t>::type = 0>
+    inline void assign_callback(C&& callback) noexcept;
+    template <typename C, typename ::std::enable_if<
+        !::std::is_copy_constructible<typename ::std::decay<C>::type>::value, int32_t>::type = 0>
+    inline void assign_callback(C&& callback) noexcept;
     void log_unfinished_data() const noexcept;
 
     static ClosureCallback* SEALED_CALLBACK;
+    // 复用状态，未复用的context由Closure直接销毁
+    static constexpr int32_t NOT_POOLED = 0;
+    static constexpr int32_t POOLED_IDLE = 1;
+    static constexpr int32_t POOLED_IN_USE = 2;
+    // 推迟release的状态
+    static constexpr int32_t RELEASE_NONE = 0;
+    static constexpr int32_t RELEASE_PENDING = 1;
+    static constexpr int32_t RELEASE_FLUSHED = 2;
+    // on_flush注册的状态
+    static constexpr int32_t FLUSH_LISTENER_NONE = 0;
+    static constexpr int32_t FLUSH_LISTENER_ARMED = 1;
+    static constexpr int32_t FLUSH_LISTENER_FLUSHED = 2;
 
     GraphExecutor* _executor;
     ::std::atomic<int64_t> _waiting_vertex_num {1};
@@ -136,7 +270,20 @@ private:
     int32_t _error_code {0};
 
     ClosureCallback* _flush_callback {nullptr};
-    ::std::vector<GraphData*> _waiting_data;
+    // on_finish回调的存储，随context一起销毁
+    ClosureCallback _finish_callback;
+    ClosureCallback* _stashed_callback {nullptr};
+    ::std::atomic<int32_t> _pool_state {NOT_POOLED};
+    ::std::atomic<bool> _cancelled {false};
+    int64_t _deadline_ns {0};
+    ::std::atomic<int32_t> _release_state {RELEASE_NONE};
+    // on_finish的callback在结束的线程上直接运行，不经过executor
+    bool _inline_callback {false};
+    ::std::atomic<int32_t> _flush_listener_state {FLUSH_LISTENER_NONE};
+    ::std::function<void()> _flush_listener;
+    // 待就绪data组成的侵入式链表，只用于结束时打印未就绪的data
+    // 链接指针存放在GraphData中，挂载时不分配内存
+    GraphData* _waiting_data {nullptr};
     size_t _all_data_num {0};
 };
 
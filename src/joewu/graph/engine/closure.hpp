@@ -4,6 +4,12 @@
 #include <joewu/graph/engine/closure.h>
 #include <joewu/graph/engine/executor.h>
 
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <thread>
+
 namespace joewu {
 namespace feed {
 namespace graph {
@@ -19,12 +25,57 @@ protected:
     virtual void notify_finish() noexcept override;
     virtual void wait_flush() noexcept override;
     virtual void notify_flush() noexcept override;
+    virtual void rearm() noexcept override;
+    // M没有限时加锁的通用接口，通过try_lock轮询实现，只用于兼容
+    virtual bool wait_finish_until(const ::timespec& abstime) noexcept override;
+    virtual bool wait_flush_until(const ::timespec& abstime) noexcept override;
 
 private:
+    static bool lock_until(M& mutex, const ::timespec& abstime) noexcept;
+
     M _mutex_finish;
     M _mutex_flush;
 };
 
+// 用一个原子状态字同时表达终止态和稳态
+// 已经进入对应状态时wait只有一次原子读，未进入时先自旋再通过W挂起
+template <typename W>
+class AtomicClosureContext : public ClosureContext {
+public:
+    inline AtomicClosureContext(GraphExecutor& executor) noexcept;
+    virtual ~AtomicClosureContext() noexcept;
+
+protected:
+    virtual void wait_finish() noexcept override;
+    virtual void notify_finish() noexcept override;
+    virtual void wait_flush() noexcept override;
+    virtual void notify_flush() noexcept override;
+    virtual void rearm() noexcept override;
+    virtual bool wait_finish_until(const ::timespec& abstime) noexcept override;
+    virtual bool wait_flush_until(const ::timespec& abstime) noexcept override;
+
+private:
+    // abstime为nullptr时不超时，超时返回false
+    inline bool wait_state(int32_t state, const ::timespec* abstime) noexcept;
+    inline void notify_state(int32_t state) noexcept;
+
+    static constexpr int32_t FINISHED = 1;
+    static constexpr int32_t FLUSHED = 2;
+    // 有挂起的等待者，notify时需要唤醒
+    static constexpr int32_t WAITING = 4;
+    static constexpr size_t SPIN_ROUND = 128;
+
+    W _waiter;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ClosureContextDeleter begin
+void ClosureContextDeleter::operator()(ClosureContext* context) const noexcept {
+    context->release();
+}
+// ClosureContextDeleter end
+///////////////////////////////////////////////////////////////////////////////
+
 ///////////////////////////////////////////////////////////////////////////////
 // Closure begin
 Closure& Closure::operator=(Closure&& closure) {
@@ -50,20 +101,42 @@ void Closure::wait() noexcept {
     return _context->wait();
 }
 
+template <typename R, typename P>
+bool Closure::get_for(const ::std::chrono::duration<R, P>& timeout,
+    int32_t& error_code) noexcept {
+    return _context->get_for(::std::chrono::duration_cast<::std::chrono::microseconds>(
+            timeout).count(), error_code);
+}
+
+template <typename R, typename P>
+bool Closure::wait_for(const ::std::chrono::duration<R, P>& timeout) noexcept {
+    return _context->wait_for(::std::chrono::duration_cast<::std::chrono::microseconds>(
+            timeout).count());
+}
+
+void Closure::cancel(int32_t error_code) noexcept {
+    _context->cancel(error_code);
+}
+
 int32_t Closure::error_code() const noexcept {
     return _context->error_code();
 }
 
 template <typename C>
-void Closure::on_finish(C&& callback) noexcept {
+void Closure::on_finish(C&& callback, bool inplace) noexcept {
     auto context = _context.release();
-    context->on_finish(::std::move(callback));
+    context->on_finish(::std::move(callback), inplace);
 }
 
 template <typename M>
 Closure Closure::create(GraphExecutor& executor) noexcept {
     return Closure(new ClosureContextImplement<M>(executor));
 }
+
+template <typename W>
+Closure Closure::create_atomic(GraphExecutor& executor) noexcept {
+    return Closure(new AtomicClosureContext<W>(executor));
+}
 // Closure end
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -80,7 +153,7 @@ ClosureContext::ClosureContext(GraphExecutor& executor) noexcept {
 void ClosureContext::finish(int32_t error_code) noexcept {
     ClosureCallback* callback = nullptr;
     if (mark_finished(error_code, callback)) {
-        if (callback != nullptr && unlikely(0 != invoke(callback))) {
+        if (callback != nullptr && unlikely(0 != dispatch(callback))) {
             LOG(WARNING) << "closure[" << this << "] invoke callback[" << callback
                 << "] failed delay to invoke on flush";
             _flush_callback = callback;
@@ -104,32 +177,91 @@ bool ClosureContext::mark_finished(int32_t error_code, ClosureCallback*& callbac
 }
 
 void ClosureContext::run(ClosureCallback* callback) noexcept {
-    (*callback)(Closure(this));
-    delete callback;
+    // 回调转移走closure后，this可能在回调运行中被归还复用或销毁
+    // 先把存放在this中的回调移到栈上再运行，不再依赖this的存活
+    ClosureCallback local_callback;
+    if (callback == &_finish_callback) {
+        local_callback = ::std::move(_finish_callback);
+        _finish_callback = nullptr;
+        callback = &local_callback;
+    }
+    Closure closure(this);
+    (*callback)(::std::move(closure));
+    // closure没有被回调转移走时，this仍然有效
+    // 否则this可能已经被归还或销毁，不能再访问
+    if (closure._context) {
+        // 就地执行时可能还在节点中，不能等待稳态
+        closure._context.release();
+        release_on_flush();
+    }
+}
+
+void ClosureContext::stash(ClosureCallback* callback) noexcept {
+    _stashed_callback = callback;
+}
+
+void ClosureContext::run_stashed() noexcept {
+    auto callback = _stashed_callback;
+    _stashed_callback = nullptr;
+    run(callback);
 }
 
 template <typename C>
-void ClosureContext::on_finish(C&& callback) noexcept {
-    using ::joewu::feed::mlarch::babylon::wrap_moveable_function;
-    auto new_callback = new ClosureCallback(
-        wrap_moveable_function(::std::move(callback)));
+void ClosureContext::on_finish(C&& callback, bool inplace) noexcept {
+    // 已经结束时直接调用，不经过存储
+    // 也避免在回调中再次注册时覆盖正在运行的回调
+    if (_callback.load(::std::memory_order_acquire) != nullptr) {
+        wait_finish();
+        callback(Closure(this));
+        return;
+    }
+    assign_callback(::std::move(callback));
+    // 通过下面的CAS发布，结束方看到callback时一定能看到这个标记
+    _inline_callback = inplace;
     ClosureCallback* expected = nullptr;
-    if (!_callback.compare_exchange_strong(expected, new_callback, 
+    if (!_callback.compare_exchange_strong(expected, &_finish_callback,
         ::std::memory_order_acq_rel)) {
         // 直接callback，有可能error_code还没生效
         // todo：这里有微概率阻塞一会儿，可以想想更好的同步方法
         wait_finish();
-        run(new_callback);
+        run(&_finish_callback);
     }
 }
 
+void ClosureContext::on_flush(::std::function<void()>&& listener) noexcept {
+    _flush_listener = ::std::move(listener);
+    int32_t state = FLUSH_LISTENER_NONE;
+    if (_flush_listener_state.compare_exchange_strong(state, FLUSH_LISTENER_ARMED,
+                ::std::memory_order_acq_rel)) {
+        // 由进入稳态的一方通知
+        return;
+    }
+    listener = ::std::move(_flush_listener);
+    _flush_listener = nullptr;
+    listener();
+}
+
+template <typename C, typename ::std::enable_if<
+    ::std::is_copy_constructible<typename ::std::decay<C>::type>::value, int32_t>::type>
+void ClosureContext::assign_callback(C&& callback) noexcept {
+    _finish_callback = ::std::forward<C>(callback);
+}
+
+template <typename C, typename ::std::enable_if<
+    !::std::is_copy_constructible<typename ::std::decay<C>::type>::value, int32_t>::type>
+void ClosureContext::assign_callback(C&& callback) noexcept {
+    using ::joewu::feed::mlarch::babylon::wrap_moveable_function;
+    _finish_callback = wrap_moveable_function(::std::move(callback));
+}
+
 void ClosureContext::fire() noexcept {
     depend_data_sub();
     depend_vertex_sub();
 }
 
 bool ClosureContext::finished() const noexcept {
-    return _callback.load(::std::memory_order_relaxed);
+    // 注册了on_finish之后_callback也非空，只有封存才表示终止
+    return _callback.load(::std::memory_order_relaxed) == SEALED_CALLBACK;
 }
 
 void ClosureContext::depend_vertex_add() noexcept {
@@ -144,13 +276,22 @@ void ClosureContext::depend_vertex_sub() noexcept {
         ClosureCallback* callback = nullptr;
         if (mark_finished(-1, callback)) {
             log_unfinished_data();
-            if (callback != nullptr && unlikely(0 != invoke(callback))) {
+            if (callback != nullptr && unlikely(0 != dispatch(callback))) {
                 LOG(WARNING) << "closure[" << this << "] invoke callback[" << callback
                     << "] failed delay to invoke on flush";
                 _flush_callback = callback;
             }
         }
 
+        // notify之后this可能被等待方销毁，先记录是否需要代为release
+        // 注册的稳态通知也先移到栈上，通知过程中this同样可能被释放
+        auto release_state = _release_state.exchange(RELEASE_FLUSHED,
+                ::std::memory_order_acq_rel);
+        ::std::function<void()> flush_listener;
+        if (FLUSH_LISTENER_ARMED == _flush_listener_state.exchange(
+                    FLUSH_LISTENER_FLUSHED, ::std::memory_order_acq_rel)) {
+            flush_listener.swap(_flush_listener);
+        }
         if (_flush_callback != nullptr) {
             notify_flush();
             callback = _flush_callback;
@@ -159,6 +300,12 @@ void ClosureContext::depend_vertex_sub() noexcept {
         } else {
             notify_flush();
         }
+        if (flush_listener) {
+            flush_listener();
+        }
+        if (release_state == RELEASE_PENDING) {
+            release_now();
+        }
     }
 }
 
@@ -167,17 +314,13 @@ void ClosureContext::depend_data_add() noexcept {
     LOG(DEBUG) << "waiting data num after add 1:" <<  waiting_num + 1;
 }
 
-void ClosureContext::add_waiting_data(GraphData* data) noexcept {
-    _waiting_data.emplace_back(data);
-}
-
 void ClosureContext::depend_data_sub() noexcept {
     int64_t waiting_num = _waiting_data_num.fetch_sub(1, ::std::memory_order_acq_rel) - 1;
     LOG(DEBUG) << "waiting data num after sub 1:" << waiting_num;
     if (waiting_num == 0) {
         ClosureCallback* callback = nullptr;
         if (mark_finished(0, callback)) {
-            if (callback != nullptr && unlikely(0 != invoke(callback))) {
+            if (callback != nullptr && unlikely(0 != dispatch(callback))) {
                 _flush_callback = callback;
             }
         }
@@ -203,13 +346,183 @@ void ClosureContext::wait() noexcept {
     wait_flush();
 }
 
+bool ClosureContext::get_for(int64_t timeout_us, int32_t& error_code) noexcept {
+    if (!wait_finish_until(abstime_after(timeout_us))) {
+        LOG(DEBUG) << "closure[" << this << "] wait data timeout after " << timeout_us << "us";
+        return false;
+    }
+    error_code = _error_code;
+    return true;
+}
+
+bool ClosureContext::wait_for(int64_t timeout_us) noexcept {
+    return wait_flush_until(abstime_after(timeout_us));
+}
+
+void ClosureContext::cancel(int32_t error_code) noexcept {
+    LOG(DEBUG) << "closure[" << this << "] cancelled with code[" << error_code << "]";
+    // 先标记再结束，被回调唤醒的一方一定能观察到取消
+    _cancelled.store(true, ::std::memory_order_release);
+    finish(error_code);
+}
+
+bool ClosureContext::cancelled() const noexcept {
+    return _cancelled.load(::std::memory_order_acquire);
+}
+
+void ClosureContext::deadline(int64_t deadline_ns) noexcept {
+    _deadline_ns = deadline_ns;
+}
+
+bool ClosureContext::expired() const noexcept {
+    return _deadline_ns != 0 && ::std::chrono::duration_cast<::std::chrono::nanoseconds>(
+        ::std::chrono::steady_clock::now().time_since_epoch()).count() >= _deadline_ns;
+}
+
 int32_t ClosureContext::invoke(ClosureCallback* callback) noexcept {
     LOG(TRACE) << "invoking closure[" << this << "] callback[" << callback << "]";
     return _executor->run(this, callback);
 }
+
+int32_t ClosureContext::dispatch(ClosureCallback* callback) noexcept {
+    if (_inline_callback) {
+        LOG(TRACE) << "running closure[" << this << "] callback[" << callback << "] inline";
+        // 回调可能把closure转移到局部变量中丢弃，此时所在的节点还没有结束
+        // 标记在当前线程上，使其间的release转为release_on_flush
+        auto& running_context = inline_running_context();
+        auto previous_context = running_context;
+        running_context = this;
+        run(callback);
+        running_context = previous_context;
+        return 0;
+    }
+    return invoke(callback);
+}
+
+void ClosureContext::pooled() noexcept {
+    _pool_state.store(POOLED_IN_USE, ::std::memory_order_release);
+}
+
+bool ClosureContext::reuse() noexcept {
+    int32_t state = POOLED_IDLE;
+    if (!_pool_state.compare_exchange_strong(state, POOLED_IN_USE,
+                ::std::memory_order_acq_rel)) {
+        return false;
+    }
+    _waiting_vertex_num.store(1, ::std::memory_order_relaxed);
+    _waiting_data_num.store(1, ::std::memory_order_relaxed);
+    _callback.store(nullptr, ::std::memory_order_relaxed);
+    _error_code = 0;
+    _flush_callback = nullptr;
+    _stashed_callback = nullptr;
+    _waiting_data = nullptr;
+    _cancelled.store(false, ::std::memory_order_relaxed);
+    _deadline_ns = 0;
+    _release_state.store(RELEASE_NONE, ::std::memory_order_relaxed);
+    _inline_callback = false;
+    _flush_listener_state.store(FLUSH_LISTENER_NONE, ::std::memory_order_relaxed);
+    _flush_listener = nullptr;
+    rearm();
+    return true;
+}
+
+void ClosureContext::release() noexcept {
+    if (unlikely(inline_running_context() == this)) {
+        release_on_flush();
+        return;
+    }
+    release_now();
+}
+
+void ClosureContext::release_now() noexcept {
+    int32_t state = _pool_state.load(::std::memory_order_acquire);
+    if (state == POOLED_IN_USE) {
+        // 归还前需要进入稳态，和析构时的要求一致
+        wait_flush();
+        if (_pool_state.compare_exchange_strong(state, POOLED_IDLE,
+                    ::std::memory_order_acq_rel)) {
+            return;
+        }
+    }
+    delete this;
+}
+
+void ClosureContext::abandon() noexcept {
+    int32_t state = _pool_state.load(::std::memory_order_acquire);
+    while (true) {
+        if (state == POOLED_IDLE) {
+            if (_pool_state.compare_exchange_weak(state, NOT_POOLED,
+                        ::std::memory_order_acq_rel)) {
+                delete this;
+                return;
+            }
+        } else if (_pool_state.compare_exchange_weak(state, NOT_POOLED,
+                    ::std::memory_order_acq_rel)) {
+            return;
+        }
+    }
+}
+
+void ClosureContext::release_on_flush() noexcept {
+    int32_t state = RELEASE_NONE;
+    if (_release_state.compare_exchange_strong(state, RELEASE_PENDING,
+                ::std::memory_order_acq_rel)) {
+        // 由进入稳态的一方release
+        return;
+    }
+    release_now();
+}
 // ClosureContext end
 ///////////////////////////////////////////////////////////////////////////////
 
+///////////////////////////////////////////////////////////////////////////////
+// SemaphoreMutex begin
+void SemaphoreMutex::lock() noexcept {
+    ::std::unique_lock<::std::mutex> lock(_mutex);
+    while (_locked) {
+        _cond.wait(lock);
+    }
+    _locked = true;
+}
+
+bool SemaphoreMutex::try_lock() noexcept {
+    ::std::lock_guard<::std::mutex> lock(_mutex);
+    if (_locked) {
+        return false;
+    }
+    _locked = true;
+    return true;
+}
+
+void SemaphoreMutex::unlock() noexcept {
+    {
+        ::std::lock_guard<::std::mutex> lock(_mutex);
+        _locked = false;
+    }
+    _cond.notify_one();
+}
+// SemaphoreMutex end
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// FutexWaiter begin
+::std::atomic<int32_t>* FutexWaiter::word() noexcept {
+    return &_word;
+}
+
+void FutexWaiter::wait(::std::atomic<int32_t>* word, int32_t expected,
+    const ::timespec* abstime) noexcept {
+    // 使用BITSET版本才能以CLOCK_REALTIME的绝对时间作为超时
+    ::syscall(SYS_futex, word, FUTEX_WAIT_BITSET_PRIVATE | FUTEX_CLOCK_REALTIME,
+        expected, abstime, nullptr, FUTEX_BITSET_MATCH_ANY);
+}
+
+void FutexWaiter::wake_all(::std::atomic<int32_t>* word) noexcept {
+    ::syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+}
+// FutexWaiter end
+///////////////////////////////////////////////////////////////////////////////
+
 ///////////////////////////////////////////////////////////////////////////////
 // ClosureContextImplement begin
 template <typename M>
@@ -243,9 +556,146 @@ template <typename M>
 void ClosureContextImplement<M>::notify_flush() noexcept {
     _mutex_flush.unlock();
 }
+
+template <typename M>
+void ClosureContextImplement<M>::rearm() noexcept {
+    // 上一次运行已经进入稳态，两把锁都已经释放
+    _mutex_finish.lock();
+    _mutex_flush.lock();
+}
+
+template <typename M>
+bool ClosureContextImplement<M>::wait_finish_until(const ::timespec& abstime) noexcept {
+    return lock_until(_mutex_finish, abstime);
+}
+
+template <typename M>
+bool ClosureContextImplement<M>::wait_flush_until(const ::timespec& abstime) noexcept {
+    return lock_until(_mutex_flush, abstime);
+}
+
+template <typename M>
+bool ClosureContextImplement<M>::lock_until(M& mutex, const ::timespec& abstime) noexcept {
+    while (!mutex.try_lock()) {
+        if (passed(abstime)) {
+            return false;
+        }
+        ::std::this_thread::sleep_for(::std::chrono::microseconds(100));
+    }
+    mutex.unlock();
+    return true;
+}
 // ClosureContextImplement end
 ///////////////////////////////////////////////////////////////////////////////
 
+///////////////////////////////////////////////////////////////////////////////
+// AtomicClosureContext begin
+template <typename W>
+AtomicClosureContext<W>::AtomicClosureContext(GraphExecutor& executor) noexcept :
+    ClosureContext(executor) {
+    _waiter.word()->store(0, ::std::memory_order_relaxed);
+}
+
+template <typename W>
+AtomicClosureContext<W>::~AtomicClosureContext() noexcept {
+    wait_flush();
+}
+
+template <typename W>
+void AtomicClosureContext<W>::wait_finish() noexcept {
+    wait_state(FINISHED, nullptr);
+}
+
+template <typename W>
+void AtomicClosureContext<W>::notify_finish() noexcept {
+    notify_state(FINISHED);
+}
+
+template <typename W>
+void AtomicClosureContext<W>::wait_flush() noexcept {
+    wait_state(FLUSHED, nullptr);
+}
+
+template <typename W>
+void AtomicClosureContext<W>::notify_flush() noexcept {
+    notify_state(FLUSHED);
+}
+
+template <typename W>
+void AtomicClosureContext<W>::rearm() noexcept {
+    // 上一次运行已经进入稳态，等待者都已经返回
+    _waiter.word()->store(0, ::std::memory_order_relaxed);
+}
+
+template <typename W>
+bool AtomicClosureContext<W>::wait_finish_until(const ::timespec& abstime) noexcept {
+    return wait_state(FINISHED, &abstime);
+}
+
+template <typename W>
+bool AtomicClosureContext<W>::wait_flush_until(const ::timespec& abstime) noexcept {
+    return wait_state(FLUSHED, &abstime);
+}
+
+template <typename W>
+bool AtomicClosureContext<W>::wait_state(int32_t state, const ::timespec* abstime) noexcept {
+    auto word = _waiter.word();
+    int32_t current = word->load(::std::memory_order_acquire);
+    if (likely(current & state)) {
+        return true;
+    }
+    // 图通常很快结束，先短暂自旋，避免挂起和唤醒的系统调用
+    for (size_t i = 0; i < SPIN_ROUND; ++i) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+        current = word->load(::std::memory_order_acquire);
+        if (current & state) {
+            return true;
+        }
+    }
+    while (!(current & state)) {
+        // 先标记WAITING再挂起，notify据此决定是否需要唤醒
+        if (!(current & WAITING)) {
+            if (!word->compare_exchange_weak(current, current | WAITING,
+                        ::std::memory_order_acq_rel, ::std::memory_order_acquire)) {
+                continue;
+            }
+            current |= WAITING;
+        }
+        W::wait(word, current, abstime);
+        current = word->load(::std::memory_order_acquire);
+        if (!(current & state) && abstime != nullptr && passed(*abstime)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename W>
+void AtomicClosureContext<W>::notify_state(int32_t state) noexcept {
+    // 置位后等待者可能立即返回并销毁this，之后只能使用局部变量
+    auto word = _waiter.word();
+    int32_t previous = word->fetch_or(state, ::std::memory_order_acq_rel);
+    // 终止态和稳态共用一个状态字，唤醒全部等待者，未满足的会重新挂起
+    if (previous & WAITING) {
+        W::wake_all(word);
+    }
+}
+
+template <typename W>
+constexpr int32_t AtomicClosureContext<W>::FINISHED;
+template <typename W>
+constexpr int32_t AtomicClosureContext<W>::FLUSHED;
+template <typename W>
+constexpr int32_t AtomicClosureContext<W>::WAITING;
+template <typename W>
+constexpr size_t AtomicClosureContext<W>::SPIN_ROUND;
+// AtomicClosureContext end
+///////////////////////////////////////////////////////////////////////////////
+
 } // graph
 } // feed
 } // joewu
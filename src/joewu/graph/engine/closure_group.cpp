@@ -0,0 +1,110 @@
+#include <joewu/graph/engine/closure_group.h>
+
+#include <algorithm>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+///////////////////////////////////////////////////////////////////////////////
+// ClosureGroup begin
+ClosureGroup ClosureGroup::when_all(::std::vector<Closure>&& closures) noexcept {
+    auto size = closures.size();
+    return create(::std::move(closures), size, false);
+}
+
+ClosureGroup ClosureGroup::when_any(::std::vector<Closure>&& closures) noexcept {
+    auto size = closures.size();
+    return create(::std::move(closures), ::std::min<size_t>(size, 1), false);
+}
+
+ClosureGroup ClosureGroup::when_all_flushed(::std::vector<Closure>&& closures) noexcept {
+    auto size = closures.size();
+    return create(::std::move(closures), size, true);
+}
+
+ClosureGroup ClosureGroup::create(::std::vector<Closure>&& closures,
+    size_t required, bool flush) noexcept {
+    auto context = new ClosureGroupContext;
+    context->_closures.reserve(closures.size());
+    // 取出所有权，组合析构前由共享状态持有
+    for (auto& closure : closures) {
+        context->_closures.emplace_back(closure._context.release());
+    }
+    context->_waiting_num.store(required, ::std::memory_order_relaxed);
+    context->_flush = flush;
+    return ClosureGroup(context);
+}
+
+ClosureGroup::~ClosureGroup() noexcept {
+    if (_context != nullptr) {
+        _context->unref();
+    }
+}
+
+void ClosureGroup::arm(::std::function<void(ClosureGroup&&)>&& callback) noexcept {
+    auto context = _context;
+    _context = nullptr;
+    context->_callback = ::std::move(callback);
+    if (context->_waiting_num.load(::std::memory_order_relaxed) == 0) {
+        context->fire(0);
+        context->unref();
+        return;
+    }
+    auto size = context->_closures.size();
+    context->_ref_num.fetch_add(size, ::std::memory_order_relaxed);
+    for (size_t i = 0; i < size; ++i) {
+        auto closure_context = context->_closures[i];
+        if (context->_flush) {
+            closure_context->on_flush([context, i] {
+                context->arrive(i);
+            });
+            continue;
+        }
+        // 就地运行回调，省去每个closure结束时的executor调度
+        closure_context->on_finish([context, i] (Closure&& closure) {
+            context->arrive(i, ::std::move(closure));
+        }, true);
+    }
+    context->unref();
+}
+// ClosureGroup end
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// ClosureGroupContext begin
+void ClosureGroupContext::arrive(size_t index, Closure&& closure) noexcept {
+    // 所有权已经由_closures持有，最终统一释放
+    closure._context.release();
+    arrive(index);
+}
+
+void ClosureGroupContext::arrive(size_t index) noexcept {
+    if (_waiting_num.fetch_sub(1, ::std::memory_order_acq_rel) == 1) {
+        fire(index);
+    }
+    unref();
+}
+
+void ClosureGroupContext::fire(size_t index) noexcept {
+    _index = index;
+    ref();
+    _callback(ClosureGroup(this));
+}
+
+void ClosureGroupContext::unref() noexcept {
+    if (_ref_num.fetch_sub(1, ::std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    // 释放时组内closure可能还在运行，甚至就是当前所在的节点，不能等待稳态
+    for (auto closure : _closures) {
+        closure->release_on_flush();
+    }
+    delete this;
+}
+// ClosureGroupContext end
+///////////////////////////////////////////////////////////////////////////////
+
+} // graph
+} // feed
+} // joewu
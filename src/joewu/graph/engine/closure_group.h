@@ -0,0 +1,102 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_CLOSURE_GROUP_H
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_CLOSURE_GROUP_H
+
+#include <joewu/graph/engine/closure.h>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+// 多个Closure的组合，组合条件满足时只触发一次回调
+// 用于一个请求扇出到多个图时，替代逐个阻塞get
+// 回调在完成最后一个所需data的线程上直接运行，不经过executor
+// 因此回调应当尽量轻量，重的逻辑可以自行转交给其他线程
+// when_all和when_any在进入终止态时回调，此时组内的图可能还有节点在运行
+// 需要在回调中销毁或复用图时，使用when_all_flushed等待全部进入稳态
+//
+// 用法:
+// ClosureGroup::when_all(::std::move(closures)).then([] (ClosureGroup&& group) {
+//     for (size_t i = 0; i < group.size(); ++i) {
+//         group.error_code(i);
+//     }
+// });
+class ClosureGroupContext;
+class ClosureGroup {
+public:
+    // 全部进入终止态时回调
+    static ClosureGroup when_all(::std::vector<Closure>&& closures) noexcept;
+    // 任一进入终止态时回调，通过index获取首个进入终止态的序号
+    // 其余Closure继续由组合持有，全部进入稳态后才会被释放
+    static ClosureGroup when_any(::std::vector<Closure>&& closures) noexcept;
+    // 全部进入稳态时回调，回调在最后一个进入稳态的线程上运行
+    // 此时组内的图都已经没有运行中的节点，可以在回调中销毁或复用
+    static ClosureGroup when_all_flushed(::std::vector<Closure>&& closures) noexcept;
+
+    ClosureGroup() noexcept = default;
+    inline ClosureGroup(ClosureGroup&& other) noexcept;
+    inline ClosureGroup& operator=(ClosureGroup&& other) noexcept;
+    ClosureGroup(const ClosureGroup&) = delete;
+    ClosureGroup& operator=(const ClosureGroup&) = delete;
+    // 不等待组内Closure进入稳态，各自进入稳态时再释放
+    ~ClosureGroup() noexcept;
+
+    // 注册回调，组合条件满足时以等效的ClosureGroup调用
+    // 调用后当前对象不再可用，条件已经满足时在当前线程直接回调
+    template <typename C>
+    inline void then(C&& callback) noexcept;
+
+    // 组内Closure的个数
+    inline size_t size() const noexcept;
+    // 第index个Closure是否已经进入终止态
+    inline bool finished(size_t index) const noexcept;
+    // 第index个Closure进入终止态后可以获得错误码
+    inline int32_t error_code(size_t index) const noexcept;
+    // when_any中首个进入终止态的序号，when_all中为最后一个
+    inline size_t index() const noexcept;
+
+private:
+    inline ClosureGroup(ClosureGroupContext* context) noexcept;
+    static ClosureGroup create(::std::vector<Closure>&& closures,
+        size_t required, bool flush) noexcept;
+    void arm(::std::function<void(ClosureGroup&&)>&& callback) noexcept;
+
+    ClosureGroupContext* _context {nullptr};
+
+    friend class ClosureGroupContext;
+};
+
+// 组合的共享状态，由ClosureGroup和组内每个Closure的回调共同持有
+class ClosureGroupContext {
+private:
+    // 第index个Closure进入终止态，取回其所有权
+    void arrive(size_t index, Closure&& closure) noexcept;
+    // 第index个Closure满足组合所需的状态
+    void arrive(size_t index) noexcept;
+    // 组合条件满足，运行回调
+    void fire(size_t index) noexcept;
+    inline void ref() noexcept;
+    // 最后一个持有者负责释放组内的Closure
+    void unref() noexcept;
+
+    ::std::vector<ClosureContext*> _closures;
+    ::std::function<void(ClosureGroup&&)> _callback;
+    // 还需要多少个Closure进入终止态，when_any中后续到达的会减为负数
+    ::std::atomic<int64_t> _waiting_num {0};
+    ::std::atomic<size_t> _ref_num {1};
+    size_t _index {0};
+    // 等待进入稳态而不是终止态
+    bool _flush {false};
+
+    friend class ClosureGroup;
+};
+
+} // graph
+} // feed
+} // joewu
+#endif //joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_CLOSURE_GROUP_H
+
+#include <joewu/graph/engine/closure_group.hpp>
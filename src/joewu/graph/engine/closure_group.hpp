@@ -0,0 +1,59 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_CLOSURE_GROUP_HPP
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_CLOSURE_GROUP_HPP
+
+#include <joewu/graph/engine/closure_group.h>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+///////////////////////////////////////////////////////////////////////////////
+// ClosureGroup begin
+ClosureGroup::ClosureGroup(ClosureGroupContext* context) noexcept :
+    _context(context) {}
+
+ClosureGroup::ClosureGroup(ClosureGroup&& other) noexcept :
+    _context(other._context) {
+    other._context = nullptr;
+}
+
+ClosureGroup& ClosureGroup::operator=(ClosureGroup&& other) noexcept {
+    ::std::swap(_context, other._context);
+    return *this;
+}
+
+template <typename C>
+void ClosureGroup::then(C&& callback) noexcept {
+    arm(::std::function<void(ClosureGroup&&)>(::std::forward<C>(callback)));
+}
+
+size_t ClosureGroup::size() const noexcept {
+    return _context->_closures.size();
+}
+
+bool ClosureGroup::finished(size_t index) const noexcept {
+    return _context->_closures[index]->finished();
+}
+
+int32_t ClosureGroup::error_code(size_t index) const noexcept {
+    return _context->_closures[index]->error_code();
+}
+
+size_t ClosureGroup::index() const noexcept {
+    return _context->_index;
+}
+// ClosureGroup end
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// ClosureGroupContext begin
+void ClosureGroupContext::ref() noexcept {
+    _ref_num.fetch_add(1, ::std::memory_order_relaxed);
+}
+// ClosureGroupContext end
+///////////////////////////////////////////////////////////////////////////////
+
+} // graph
+} // feed
+} // joewu
+#endif //joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_CLOSURE_GROUP_HPP
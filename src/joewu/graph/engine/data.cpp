@@ -11,7 +11,7 @@ void GraphData::release() noexcept {
     ClosureContext* closure = _closure.load(::std::memory_order_relaxed);
     do {
         if (unlikely(closure == SEALED_CLOSURE)) {
-            LOG(FATAL) << "data[" << _name << "] double release, maybe a bug?";
+            LOG(FATAL) << "data[" << *_name << "] double release, maybe a bug?";
             abort();
         }
     } while (unlikely(!_closure.compare_exchange_weak(closure,
@@ -23,8 +23,11 @@ void GraphData::release() noexcept {
     if (_on_emit){
         (*_on_emit)(*(_producer), _data);
     }
-    BABYLON_STACK(GraphVertex*, runnable_vertexes, _vertex_num);
-    auto trivial_runnable_vertexes = _producer != nullptr ? _producer->runnable_vertexes()
+    BABYLON_STACK(GraphVertex*, runnable_vertexes, vertex_num());
+    // 只有在producer以平凡方式运行的线程上发布时，才能直接放入其可运行节点栈
+    // 异步算子在回调线程中发布时，原来的栈可能已经失效
+    auto trivial_runnable_vertexes = _producer != nullptr
+        && GraphVertex::running_vertex() == _producer ? _producer->runnable_vertexes()
         : nullptr;
     if (trivial_runnable_vertexes == nullptr) {
         for (auto successor : _successors) {
@@ -35,16 +38,12 @@ void GraphData::release() noexcept {
             successor->ready(this, *trivial_runnable_vertexes);
         }
     }
-    while (!runnable_vertexes.empty()) {
-        auto vertex = runnable_vertexes.back();
-        runnable_vertexes.pop_back();
-        vertex->invoke(runnable_vertexes);
-    }
+    GraphVertex::invoke_all(runnable_vertexes, _producer);
 }
 
 int32_t GraphData::recursive_activate(Stack<GraphVertex*>& runnable_vertexes, ClosureContext* closure) noexcept {
-    LOG(TRACE) << "recursive activation from data " << _name;
-    BABYLON_STACK(GraphData*, activating_data, _data_num);
+    LOG(TRACE) << "recursive activation from data " << *_name;
+    BABYLON_STACK(GraphData*, activating_data, data_num());
     trigger(activating_data);
     while (!activating_data.empty()) {
         GraphData* one_data = activating_data.back();
@@ -59,6 +58,7 @@ int32_t GraphData::recursive_activate(Stack<GraphVertex*>& runnable_vertexes, Cl
 
 ClosureContext* GraphData::SEALED_CLOSURE =
     reinterpret_cast<ClosureContext*>(0xFFFFFFFFFFFFFFFFL);
+const ::std::string GraphData::EMPTY_NAME;
 
 } // graph
 } // feed
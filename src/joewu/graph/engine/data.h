@@ -4,6 +4,7 @@
 #include <joewu/feed/mlarch/babylon/any.h>
 #include <joewu/feed/mlarch/babylon/stack.h>
 #include <joewu/feed/mlarch/babylon/concurrent/transient_queue.h>
+#include <joewu/graph/engine/aligned.h>
 #include <joewu/graph/engine/on_emit.h>
 
 namespace joewu {
@@ -89,6 +90,7 @@ private:
 //
 // 声明为可变依赖时稍微特殊，ready之后还会由依赖者修改数据
 // 通过保证此时只有唯一依赖者，来满足承诺
+class Graph;
 class GraphVertex;
 class GraphExecutor;
 class GraphDependency;
@@ -162,22 +164,29 @@ public:
     inline const ::std::string& name() const noexcept;
 
 private:
-    // 仅用于Graph中使用vector构建，藏起来避免使用者误用
+    // 仅用于Graph中使用AlignedVector构建，藏起来避免使用者误用
     inline GraphData() = default;
 
+    // 只记录引用，name需要比data存活更久
     inline void name(const ::std::string& name) noexcept;
-    inline void executer(GraphExecutor& executer) noexcept;
+    inline void graph(Graph& graph) noexcept;
     inline void producer(GraphVertex& producer) noexcept;
     inline void on_emit(const OnEmitFunction& on_emit) noexcept;
     inline void add_successor(GraphDependency& successor) noexcept;
-    inline void data_num(size_t num) noexcept;
-    inline void vertex_num(size_t num) noexcept;
+    inline void reserve_successors(size_t num) noexcept;
+    // 图规模由GraphPlan记录，单独构造的data视为空图
+    inline size_t data_num() const noexcept;
+    inline size_t vertex_num() const noexcept;
     inline GraphVertex* producer() noexcept;
     inline const GraphVertex* producer() const noexcept;
 
     inline int32_t error_code() const noexcept;
     // 重置状态，但是保留data空间
+    // 不改变待重置链表的记录，由Graph::reset统一维护
     inline void reset() noexcept;
+    // 本轮运行中首次改变状态时，将自身记入graph的待重置链表
+    // reset时只需处理链表中的data，而不用遍历整个graph
+    inline void touch() noexcept;
     // 获取发布权，竞争下只有第一次返回true，此时进入非空状态
     // 只有获得发布权后才可以进一步写操作value，以及release
     // 如果要发布空value，需要主动标记empty(true)
@@ -208,6 +217,8 @@ private:
     // 并记录closure，之后返回true，当data ready时进行通知
     // 如果data已经ready，则直接返回false
     inline bool bind(ClosureContext& closure) noexcept;
+    // 是否作为请求的结果绑定在closure上且尚未就绪
+    inline bool bound() const noexcept;
 
     // 由GraphDependency使用
     // 调用后进入不可变依赖状态
@@ -234,38 +245,47 @@ private:
         VertexStack& runnable_vertexes, ClosureContext* closure) noexcept;
 
     static ClosureContext* SEALED_CLOSURE;
+    static const ::std::string EMPTY_NAME;
 
-    // 静态信息
-    ::std::string _name;
+    // 静态信息，build之后只读
+    // 名字由GraphPlan持有，这里只引用
+    const ::std::string* _name {&EMPTY_NAME};
     GraphVertex* _producer {nullptr};
     ::std::vector<GraphDependency*> _successors;
-    GraphExecutor* _executer {nullptr};
-    size_t _data_num {0};
-    size_t _vertex_num {0};
+    Graph* _graph {nullptr};
     const Any::Id* _declare_type {nullptr};
-    bool _error_code {0};
+    //数据发布前调用
+    const OnEmitFunction* _on_emit{nullptr};
 
+    // 以下为运行状态，会被多个线程并发修改
+    // 从独立的缓存行开始，且整体按缓存行对齐
+    // 避免和自身的静态信息，以及vector中相邻data的运行状态伪共享
     // 数据信息
-    ::std::atomic<bool> _acquired {false};
-    Any _data;
+    alignas(64) ::std::atomic<bool> _acquired {false};
     bool _empty {true};
     bool _has_preset_value {false};
-
     // 推导信息
     bool _active {false};
-    ::std::atomic<ClosureContext*> _closure {nullptr};
     ::std::atomic<int32_t> _depend_state {0};
-    //数据发布前调用
-    const OnEmitFunction* _on_emit{nullptr};
+    ::std::atomic<ClosureContext*> _closure {nullptr};
+    // 绑定的closure中待就绪data链表的下一个节点
+    GraphData* _next_waiting_data {nullptr};
+    // 本轮运行中是否已经记入待重置链表，以及链表中的下一个节点
+    ::std::atomic<bool> _touched {false};
+    // 只在build时写入和检查，放在运行状态的填充空间中，使静态信息恰好占用一个缓存行
+    bool _error_code {0};
+    GraphData* _next_touched_data {nullptr};
+    Any _data;
 
     template <typename T>
     friend class Commiter;
-    friend void ::std::_Construct<GraphData>(GraphData*);
+    friend class AlignedAllocator<GraphData>;
     friend ::std::ostream& operator<<(::std::ostream&, const GraphData&);
     friend class Graph;
     friend class GraphBuilder;
     friend class ClosureContext;
     friend class GraphDependency;
+    friend class GraphVertex;
     friend class GraphVertexBuilder;
     friend class GraphDependencyBuilder;
 };
@@ -5,6 +5,7 @@
 #include <joewu/graph/engine/vertex.h>
 #include <joewu/graph/engine/closure.h>
 #include <joewu/graph/engine/dependency.h>
+#include <joewu/graph/engine/graph.h>
 
 namespace joewu {
 namespace feed {
@@ -142,11 +143,11 @@ inline bool GraphData::empty() const noexcept {
 }
 
 inline void GraphData::name(const ::std::string& name) noexcept {
-    _name = name;
+    _name = &name;
 }
 
 inline const ::std::string& GraphData::name() const noexcept {
-    return _name;
+    return *_name;
 }
 
 inline int32_t GraphData::error_code() const noexcept {
@@ -162,6 +163,19 @@ inline void GraphData::reset() noexcept {
     _depend_state.store(0, ::std::memory_order_relaxed);
 }
 
+inline void GraphData::touch() noexcept {
+    // 绝大多数调用发生在已经记录过的data上，先读一次避免写竞争
+    if (likely(_touched.load(::std::memory_order_relaxed))) {
+        return;
+    }
+    if (unlikely(_touched.exchange(true, ::std::memory_order_acq_rel))) {
+        return;
+    }
+    if (likely(_graph != nullptr)) {
+        _graph->touch(*this);
+    }
+}
+
 inline GraphVertex* GraphData::producer() noexcept {
     return _producer;
 }
@@ -182,35 +196,47 @@ inline bool GraphData::bind(ClosureContext& closure) noexcept {
     // todo: 多次bind进行链式挂载
     ClosureContext* expected = nullptr;
     closure.depend_data_add();
-    closure.add_waiting_data(this);
     if (unlikely(!_closure.compare_exchange_strong(expected, &closure,
                 ::std::memory_order_acq_rel))) {
         closure.depend_data_sub();
         return false;
     }
+    // 绑定成功后才挂入链表，避免破坏已经绑定的其他closure的链表
+    closure.add_waiting_data(this);
+    touch();
     return true;
 }
 
-inline void GraphData::data_num(size_t num) noexcept {
-    _data_num = num;
+inline bool GraphData::bound() const noexcept {
+    auto closure = _closure.load(::std::memory_order_acquire);
+    return closure != nullptr && closure != SEALED_CLOSURE;
+}
+
+inline size_t GraphData::data_num() const noexcept {
+    return likely(_graph != nullptr) ? _graph->data_size() : 0;
 }
 
-inline void GraphData::vertex_num(size_t num) noexcept {
-    _vertex_num = num;
+inline size_t GraphData::vertex_num() const noexcept {
+    return likely(_graph != nullptr) ? _graph->vertex_size() : 0;
 }
 
-inline void GraphData::executer(GraphExecutor& executer) noexcept {
-    _executer = &executer;
+inline void GraphData::graph(Graph& graph) noexcept {
+    _graph = &graph;
 }
 
 inline void GraphData::add_successor(GraphDependency& successor) noexcept {
     _successors.push_back(&successor);
 }
 
+inline void GraphData::reserve_successors(size_t num) noexcept {
+    _successors.reserve(num);
+}
+
 inline bool GraphData::acquire() noexcept {
     bool expected = false;
     if (likely(_acquired.compare_exchange_strong(expected, true,
                 ::std::memory_order_acq_rel))) {
+        touch();
         return true;
     }
     return false;
@@ -298,6 +324,7 @@ template <typename T>
 inline void GraphData::preset(T& value) noexcept {
     _data.ref(value);
     _has_preset_value = true;
+    touch();
 }
 
 inline bool GraphData::has_preset_value() const noexcept {
@@ -306,17 +333,22 @@ inline bool GraphData::has_preset_value() const noexcept {
 
 inline bool GraphData::mark_active() noexcept {
     bool already_active = _active;
-    _active = true;
+    if (!already_active) {
+        _active = true;
+        touch();
+    }
     return already_active;
 }
 
 inline bool GraphData::acquire_immutable_depend() noexcept {
     auto state = _depend_state.exchange(1, ::std::memory_order_relaxed);
+    touch();
     return state != 2;
 }
 
 inline bool GraphData::acquire_mutable_depend() noexcept {
     auto state = _depend_state.exchange(2, ::std::memory_order_relaxed);
+    touch();
     return state == 0;
 }
 
@@ -391,10 +423,10 @@ inline void GraphData::empty(bool empty) noexcept {
 }
 
 inline void GraphData::trigger(Stack<GraphData*>& activating_data) noexcept {
-    LOG(TRACE) << "triggering data " << _name;
+    LOG(TRACE) << "triggering data " << *_name;
     if (!mark_active()) {
         if (!ready()) {
-            LOG(DEBUG) << "data " << _name << " triggered";
+            LOG(DEBUG) << "data " << *_name << " triggered";
             activating_data.emplace(this);
         }
     }
@@ -402,22 +434,22 @@ inline void GraphData::trigger(Stack<GraphData*>& activating_data) noexcept {
 
 inline int32_t GraphData::activate(Stack<GraphData*>& activating_data,
     Stack<GraphVertex*>& runnable_vertexes, ClosureContext* closure) noexcept {
-    LOG(TRACE) << "activating data " << _name;
+    LOG(TRACE) << "activating data " << *_name;
     // trigger时检测过一次ready，送给activate的如果没有producer直接报错
     if (unlikely(_producer == nullptr)) {
-        LOG(WARNING) << "can not activate data[" << _name << "] with no producer";
+        LOG(WARNING) << "can not activate data[" << *_name << "] with no producer";
         return -1;
     }
     if (unlikely(0 != _producer->activate(activating_data, runnable_vertexes, closure))) {
         LOG(WARNING) << "activate producer vertex["
-            << _producer->index() << "] of data[" << _name << "] failed";
+            << _producer->index() << "] of data[" << *_name << "] failed";
         return -1;
     }
     return 0;
 }
 
 inline ::std::ostream& operator<<(::std::ostream& os, const ::joewu::feed::graph::GraphData& data) {
-    os << "data[" << data._name << "]";
+    os << "data[" << *data._name << "]";
     return os;
 }
 // GraphData end
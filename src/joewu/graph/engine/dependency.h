@@ -139,6 +139,7 @@ private:
     // 是否强依赖，如果强依赖则要求target不为空才能触发_source
     bool _essential {false};
 
+    friend class Graph;
     friend class GraphData;
     friend class GraphVertex;
     friend class ClosureContext;
@@ -1,57 +1,138 @@
-#include <tuple>
 #include <bthread.h>
-#include <bthread/mutex.h>
+#include <bthread/butex.h>
 #include <joewu/graph/engine/executor.h>
 #include <joewu/graph/engine/vertex.h>
 
+#include <memory>
+
 namespace joewu {
 namespace feed {
 namespace graph {
 
+void GraphExecutor::run_vertex(GraphVertex* vertex,
+    GraphVertexClosure&& closure) noexcept {
+    vertex->run(::std::move(closure));
+}
+
+GraphVertexClosure GraphExecutor::create_vertex_closure(GraphVertex* vertex) noexcept {
+    return GraphVertexClosure(*vertex->_closure, *vertex);
+}
+
+ClosureContext* GraphExecutor::closure_of(GraphVertex* vertex) noexcept {
+    return vertex->_closure;
+}
+
+void GraphExecutor::stash(GraphVertex* vertex, GraphVertexClosure&& closure) noexcept {
+    vertex->_stashed_closure = ::std::move(closure);
+}
+
+GraphVertexClosure GraphExecutor::unstash(GraphVertex* vertex) noexcept {
+    return ::std::move(vertex->_stashed_closure);
+}
+
+int32_t GraphExecutor::run(GraphVertex* vertexes[], size_t size) noexcept {
+    int32_t ret = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (0 != run(vertexes[i], create_vertex_closure(vertexes[i]))) {
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+int32_t GraphExecutor::run(::std::function<void()>&&) noexcept {
+    return -1;
+}
+
 void* execute_invoke_vertex(void* args) {
-    auto param = reinterpret_cast<::std::tuple<GraphVertex*, GraphVertexClosure>*>(args);
-    auto vertex = ::std::get<0>(*param);
-    auto& closure = ::std::get<1>(*param);
+    auto vertex = reinterpret_cast<GraphVertex*>(args);
+    // 先移出到栈上，运行结束后graph可能已经被销毁
+    GraphVertexClosure closure(::std::move(vertex->_stashed_closure));
     vertex->run(::std::move(closure));
-    delete param;
     return NULL;
 }
 
 static void* execute_invoke_closure(void* args) {
-    auto param = reinterpret_cast<::std::tuple<ClosureContext*, ClosureCallback*>*>(args);
-    auto closure = ::std::get<0>(*param);
-    auto callback = ::std::get<1>(*param);
-    closure->run(callback);
-    delete param;
+    reinterpret_cast<ClosureContext*>(args)->run_stashed();
     return NULL;
 }
 
+static void* execute_invoke_function(void* args) {
+    ::std::unique_ptr<::std::function<void()>> function(
+        reinterpret_cast<::std::function<void()>*>(args));
+    (*function)();
+    return NULL;
+}
+
+ButexWaiter::ButexWaiter() noexcept :
+    _word(::bthread::butex_create_checked<::std::atomic<int32_t>>()) {}
+
+ButexWaiter::~ButexWaiter() noexcept {
+    ::bthread::butex_destroy(_word);
+}
+
+void ButexWaiter::wait(::std::atomic<int32_t>* word, int32_t expected,
+    const ::timespec* abstime) noexcept {
+    ::bthread::butex_wait(word, expected, abstime);
+}
+
+void ButexWaiter::wake_all(::std::atomic<int32_t>* word) noexcept {
+    ::bthread::butex_wake_all(word);
+}
+
 Closure BthreadGraphExecutor::create_closure() noexcept {
-    return Closure::create<::bthread::Mutex>(*this);
+    return Closure::create_atomic<ButexWaiter>(*this);
 }
 
 int32_t BthreadGraphExecutor::run(GraphVertex* vertex,
     GraphVertexClosure&& closure) noexcept {
     bthread_t th;
-    auto param = new ::std::tuple<GraphVertex*, GraphVertexClosure>(
-        vertex, ::std::move(closure));
-    if (0 != bthread_start_background(&th, NULL, execute_invoke_vertex, param)) {
+    // 参数暂存在vertex中，稳态下调度不产生内存分配
+    stash(vertex, ::std::move(closure));
+    if (0 != bthread_start_background(&th, NULL, execute_invoke_vertex, vertex)) {
         LOG(WARNING) << "start bthread to run vertex failed";
-        closure = ::std::move(::std::get<1>(*param));
-        delete param;
+        closure = unstash(vertex);
         return -1;
     }
     return 0;
 }
 
+int32_t BthreadGraphExecutor::run(GraphVertex* vertexes[], size_t size) noexcept {
+    bthread_attr_t attr = BTHREAD_ATTR_NORMAL;
+    attr.flags |= BTHREAD_NOSIGNAL;
+    int32_t ret = 0;
+    for (size_t i = 0; i < size; ++i) {
+        bthread_t th;
+        stash(vertexes[i], create_vertex_closure(vertexes[i]));
+        if (0 != bthread_start_background(&th, &attr, execute_invoke_vertex, vertexes[i])) {
+            LOG(WARNING) << "start bthread to run " << *vertexes[i] << " failed";
+            unstash(vertexes[i]);
+            ret = -1;
+        }
+    }
+    bthread_flush();
+    return ret;
+}
+
 int32_t BthreadGraphExecutor::run(ClosureContext* closure,
     ClosureCallback* callback) noexcept {
     bthread_t th;
-    auto param = new ::std::tuple<ClosureContext*, ClosureCallback*>(
-        closure, callback);
-    if (0 != bthread_start_background(&th, NULL, execute_invoke_closure, param)) {
+    closure->stash(callback);
+    if (0 != bthread_start_background(&th, NULL, execute_invoke_closure, closure)) {
         LOG(WARNING) << "start bthread to run closure failed";
-        delete param;
+        closure->stash(nullptr);
+        return -1;
+    }
+    return 0;
+}
+
+int32_t BthreadGraphExecutor::run(::std::function<void()>&& function) noexcept {
+    bthread_t th;
+    auto args = new ::std::function<void()>(::std::move(function));
+    if (0 != bthread_start_background(&th, NULL, execute_invoke_function, args)) {
+        LOG(WARNING) << "start bthread to run function failed";
+        function = ::std::move(*args);
+        delete args;
         return -1;
     }
     return 0;
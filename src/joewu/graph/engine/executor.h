@@ -3,6 +3,9 @@
 
 #include <joewu/feed/mlarch/babylon/function.h>
 
+#include <atomic>
+#include <time.h>
+
 namespace joewu {
 namespace feed {
 namespace graph {
@@ -28,6 +31,49 @@ public:
     // 使用相应的调度机制执行一个closure的callback
     // 返回非0标识未能完成调度，此时确保callback未被执行
     virtual int32_t run(ClosureContext* closure, ::std::function<void(Closure&&)>* callback) noexcept = 0;
+    // 批量执行一组vertex，典型如一个data就绪后扇出的多个后继
+    // 默认逐个调用run，executor可以覆盖，用一次入队和一次唤醒完成整批调度
+    // vertexes按调度优先级从高到低排列，executor应尽量让靠前的先开始运行
+    // 返回非0标识有vertex未能完成调度，与单个run失败时一样
+    // 这些vertex不会被执行，其closure会被直接结束
+    virtual int32_t run(GraphVertex* vertexes[], size_t size) noexcept;
+    // 使用相应的调度机制执行一个普通函数，典型如算子攒批超时后的异步处理
+    // 返回非0标识未能完成调度，此时确保function未被执行且依旧可用
+    // 默认不支持，调用方需要自行运行
+    virtual int32_t run(::std::function<void()>&& function) noexcept;
+
+protected:
+    // 供派生的执行器在准备好的执行环境中实际运行vertex
+    static void run_vertex(GraphVertex* vertex, GraphVertexClosure&& closure) noexcept;
+    // 为激活后的vertex创建closure，供批量接口的实现使用
+    static GraphVertexClosure create_vertex_closure(GraphVertex* vertex) noexcept;
+    // 获取vertex所在的这次图运行的closure
+    static ClosureContext* closure_of(GraphVertex* vertex) noexcept;
+    // 将closure暂存在vertex中，调度时只需要传递vertex指针，省去任务对象的分配
+    static void stash(GraphVertex* vertex, GraphVertexClosure&& closure) noexcept;
+    // 取回暂存的closure，用于调度失败时的回退
+    static GraphVertexClosure unstash(GraphVertex* vertex) noexcept;
+};
+
+// 基于butex的等待器，满足AtomicClosureContext对W的要求
+// 在bthread中只挂起bthread，在pthread中同样可用
+// butex内存由bthread对象池管理不会归还，销毁后仍可安全唤醒
+class ButexWaiter {
+public:
+    ButexWaiter() noexcept;
+    ~ButexWaiter() noexcept;
+    ButexWaiter(const ButexWaiter&) = delete;
+    ButexWaiter& operator=(const ButexWaiter&) = delete;
+
+    inline ::std::atomic<int32_t>* word() noexcept {
+        return _word;
+    }
+    static void wait(::std::atomic<int32_t>* word, int32_t expected,
+        const ::timespec* abstime) noexcept;
+    static void wake_all(::std::atomic<int32_t>* word) noexcept;
+
+private:
+    ::std::atomic<int32_t>* _word;
 };
 
 // 使用bthread进行调度的图执行器
@@ -41,6 +87,9 @@ public:
     virtual int32_t run(GraphVertex* vertex,
         GraphVertexClosure&& closure) noexcept override;
     virtual int32_t run(ClosureContext* closure, ::std::function<void(Closure&&)>* callback) noexcept override;
+    // 批量启动bthread时不逐个唤醒worker，全部提交后统一flush
+    virtual int32_t run(GraphVertex* vertexes[], size_t size) noexcept override;
+    virtual int32_t run(::std::function<void()>&& function) noexcept override;
 };
 
 } // graph
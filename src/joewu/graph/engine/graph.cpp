@@ -3,40 +3,45 @@
 #include <joewu/graph/engine/vertex.h>
 #include <joewu/graph/engine/executor.h>
 
+#include <algorithm>
+
 namespace joewu {
 namespace feed {
 namespace graph {
 
 Graph::Graph(GraphExecutor& executer,
-    size_t vertex_size,
-    const ::std::unordered_map<::std::string, size_t>& data_index_by_name) noexcept :
-    _executor(&executer), _vertexes(vertex_size), 
-    _data(data_index_by_name.size()) {
-    for (const auto& pair : data_index_by_name) {
-        auto& data = _data[pair.second];
-        data.executer(*_executor);
-        data.name(pair.first);
-        data.data_num(_data.size());
-        data.vertex_num(_vertexes.size());
-        _data_by_name.emplace(::std::make_pair(pair.first, &data));
+    const ::std::shared_ptr<const GraphPlan>& plan) noexcept :
+    _executor(&executer), _plan(plan), _vertexes(plan->vertex_size()),
+    _data(plan->data_size()) {
+    for (size_t i = 0; i < _data.size(); ++i) {
+        auto& data = _data[i];
+        data.graph(*this);
+        data.name(_plan->data_name(i));
+        data.reserve_successors(_plan->successor_num(i));
     }
 }
 
-::std::vector<GraphData>& Graph::data() noexcept {
+Graph::~Graph() noexcept {
+    if (_closure_context != nullptr) {
+        _closure_context->abandon();
+    }
+}
+
+AlignedVector<GraphData>& Graph::data() noexcept {
     return _data;
 }
 
-::std::vector<GraphVertex>& Graph::vertexes() noexcept {
+AlignedVector<GraphVertex>& Graph::vertexes() noexcept {
     return _vertexes;
 }
 
 GraphData* Graph::find_data(const ::std::string& name) noexcept {
-    auto it = _data_by_name.find(name);
-    if (unlikely(it == _data_by_name.end())) {
+    size_t index = 0;
+    if (unlikely(!_plan->data_index(name, index))) {
         LOG(WARNING) << "no data named " << name << " in graph";
         return nullptr;
     }
-    return it->second;
+    return &_data[index];
 }
 
 int Graph::func_each_vertex(std::function<int(GraphVertex&)> func) noexcept {
@@ -51,22 +56,128 @@ int Graph::func_each_vertex(std::function<int(GraphVertex&)> func) noexcept {
 }
 
 void Graph::reset() noexcept {
-    for (auto& one_data : _data) {
-        one_data.reset();
+    // vertex的状态只会在激活，或者依赖的data发布时改变
+    // 因此从触及的data出发，收集producer和消费者即可覆盖全部变化
+    BABYLON_STACK(GraphVertex*, touched_vertexes, _vertexes.size());
+    auto touch_vertex = [&] (GraphVertex* vertex) {
+        if (vertex != nullptr && !vertex->_touched) {
+            vertex->_touched = true;
+            touched_vertexes.emplace(vertex);
+        }
+    };
+    auto data = _touched_data.exchange(nullptr, ::std::memory_order_acquire);
+    while (data != nullptr) {
+        auto next = data->_next_touched_data;
+        touch_vertex(data->_producer);
+        for (auto successor : data->_successors) {
+            touch_vertex(successor->_source);
+        }
+        data->reset();
+        data->_touched.store(false, ::std::memory_order_relaxed);
+        data->_next_touched_data = nullptr;
+        data = next;
     }
-    for (auto& vertex : _vertexes) {
-        vertex.reset();
+    while (!touched_vertexes.empty()) {
+        touched_vertexes.back()->reset();
+        touched_vertexes.pop_back();
     }
+    _deadline_ns = 0;
     #ifdef GOOGLE_PROTOBUF_HAS_ARENAS
     _arena_mem_manager.clear();
     #endif // GOOGLE_PROTOBUF_HAS_ARENAS
 }
 
+int32_t Graph::invalidate(GraphData* data[], size_t size) noexcept {
+    // 从指定data出发，沿消费关系收集下游锥内的vertex
+    // 借用reset时的去重标记，vertex.reset会将其清除
+    BABYLON_STACK(GraphVertex*, cone_vertexes, _vertexes.size());
+    BABYLON_STACK(GraphData*, pending_data, _data.size() + size);
+    for (size_t i = 0; i < size; ++i) {
+        pending_data.emplace(data[i]);
+    }
+    while (!pending_data.empty()) {
+        auto one_data = pending_data.back();
+        pending_data.pop_back();
+        for (auto successor : one_data->_successors) {
+            auto vertex = successor->_source;
+            if (vertex == nullptr || vertex->_touched) {
+                continue;
+            }
+            vertex->_touched = true;
+            cone_vertexes.emplace(vertex);
+            for (auto emit : vertex->_emits) {
+                pending_data.emplace(emit);
+            }
+        }
+    }
+
+    // 可变依赖的目标只能来自锥内或者由调用方重新发布
+    auto in_cone = [&] (GraphData* target) {
+        if (target->_producer != nullptr && target->_producer->_touched) {
+            return true;
+        }
+        return ::std::find(data, data + size, target) != data + size;
+    };
+    for (size_t i = 0; i < cone_vertexes.size(); ++i) {
+        for (auto& dependency : cone_vertexes[i]->_dependencies) {
+            if (unlikely(dependency._mutable && !in_cone(dependency._target))) {
+                LOG(WARNING) << *cone_vertexes[i] << " mutable depend on "
+                    << *dependency._target << " out of invalidated cone";
+                for (size_t j = 0; j < cone_vertexes.size(); ++j) {
+                    cone_vertexes[j]->_touched = false;
+                }
+                return -1;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < size; ++i) {
+        data[i]->reset();
+    }
+    for (size_t i = 0; i < cone_vertexes.size(); ++i) {
+        for (auto emit : cone_vertexes[i]->_emits) {
+            emit->reset();
+        }
+    }
+    // 锥外的data已经就绪，发布时对这些vertex的通知随reset丢失
+    // 按照发布流程重新通知一次，激活时即可视为已经就绪
+    // 此时vertex尚未激活，等待计数不会归零，不会产生可运行节点
+    BABYLON_STACK(GraphVertex*, runnable_vertexes, _vertexes.size());
+    for (size_t i = 0; i < cone_vertexes.size(); ++i) {
+        auto vertex = cone_vertexes[i];
+        vertex->reset();
+        for (auto& dependency : vertex->_dependencies) {
+            if (dependency._condition != nullptr && dependency._condition->ready()) {
+                dependency.ready(dependency._condition, runnable_vertexes);
+            }
+            if (dependency._target->ready()) {
+                dependency.ready(dependency._target, runnable_vertexes);
+            }
+        }
+    }
+    LOG(TRACE) << "invalidate " << cone_vertexes.size() << " vertexes from "
+        << size << " data";
+    return 0;
+}
+
+Closure Graph::create_closure() noexcept {
+    if (likely(_closure_context != nullptr && _closure_context->reuse())) {
+        return Closure(_closure_context);
+    }
+    auto closure = _executor->create_closure();
+    if (_closure_context == nullptr) {
+        _closure_context = closure.context();
+        _closure_context->pooled();
+    }
+    return closure;
+}
+
 Closure Graph::run(GraphData* data[], size_t size) noexcept {
     LOG(TRACE) << "run graph for " << size << " data";
-    auto closure = _executor->create_closure();
+    auto closure = create_closure();
     auto context = closure.context();
     context->all_data_num(_data.size());
+    context->deadline(_deadline_ns);
     BABYLON_STACK(GraphVertex*, runnable_vertexes, _vertexes.size());
     for (size_t i = 0; i < size; ++i) {
         if (unlikely(!data[i]->bind(*context))) {
@@ -81,13 +192,7 @@ Closure Graph::run(GraphData* data[], size_t size) noexcept {
     }
 
     LOG(TRACE) << "vertexes size:" << runnable_vertexes.size();
-    // lijiang01 todo: 区分是否是trivial算子，先启动其他算子的异步执行
-    // 最后再串行执行这些trivial算子
-    while (!runnable_vertexes.empty()) {
-        auto vertex = runnable_vertexes.back();
-        runnable_vertexes.pop_back();
-        vertex->invoke(runnable_vertexes);
-    }
+    GraphVertex::invoke_all(runnable_vertexes, nullptr);
     context->fire();
     return closure;
 }
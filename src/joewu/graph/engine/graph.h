@@ -2,9 +2,13 @@
 #define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_GRAPH_H  
 
 #include <vector>
-#include <unordered_map>
+#include <chrono>
+#include <memory>
 #include <joewu/feed/mlarch/babylon/stack.h>
+#include <joewu/graph/engine/aligned.h>
 #include <joewu/graph/engine/closure.h>
+#include <joewu/graph/engine/graph_plan.h>
+#include <joewu/graph/engine/handle.h>
 #include <joewu/feed/mlarch/babylon/any.h>
 #include <joewu/feed/mlarch/babylon/reusable/manager.h>
 
@@ -24,10 +28,15 @@ public:
     inline size_t data_size() const noexcept;
     inline size_t vertex_size() const noexcept;
     // 清理执行状态，但是保留data空间
+    // 只处理上次reset以来被触及的data，以及它们的producer和消费者
+    // 只激活了一小部分的大图，reset代价和触及的规模成正比
     void reset() noexcept;
     // 通过name找到GraphData
     // 用于直接向data赋值，或发起求值
     GraphData* find_data(const ::std::string& name) noexcept ;
+    // 通过GraphBuilder::data_handle预先解析的句柄获取data，省去按名字查找
+    // 句柄无效时返回nullptr
+    inline GraphData* find_data(const DataHandle& handle) noexcept;
     // 以指定的一系列GraphData为目的开始求值
     // 以指定的一系列GraphData为目的开始求值
     // 先检测这些data是否就绪，未就绪的找到producer，没有producer的报错退出
@@ -41,6 +50,19 @@ public:
     template <typename ...D>
     inline Closure run(D... data) noexcept;
     Closure run(GraphData* data[], size_t size) noexcept;
+    // 增量重新执行，使指定data及其传递下游失效，其余已经就绪的data保持不变
+    // 之后由调用方重新发布这些data，再以需要的data为目标run
+    // 只有下游锥内的节点会重新运行，指定data的producer不会重新运行
+    // 需要在上一次运行进入稳态后调用，不可和run并发
+    // 锥内节点可变依赖锥外的data时，其原值已被修改无法复用
+    // 此时返回-1，且不做任何修改
+    template <typename ...D>
+    inline int32_t invalidate(D... data) noexcept;
+    int32_t invalidate(GraphData* data[], size_t size) noexcept;
+    // 设置之后运行的deadline，reset时清除
+    // 超过deadline后，尚未开始且产出只被非必要依赖消费的节点直接发布空的emits
+    // 消费者使用已经就绪的部分继续运行，已经开始运行的节点不受影响
+    inline void deadline(::std::chrono::steady_clock::time_point deadline) noexcept;
 
     // 对Graph中每个GraphVertex执行一次func调用
     int func_each_vertex(std::function<int(GraphVertex&)> func) noexcept;
@@ -63,14 +85,16 @@ public:
         return _arena_mem_manager;
     }
     #endif //GOOGLE_PROTOBUF_HAS_ARENAS
+    // 复用的closure仍被外部持有时，转交给持有者销毁
+    ~Graph() noexcept;
+
 private:
     // 单测使用
     inline Graph() = default;
     inline Graph(const Graph&) = delete;
-    Graph(GraphExecutor&, size_t,
-        const ::std::unordered_map<::std::string, size_t>&) noexcept;
-    ::std::vector<GraphVertex>& vertexes() noexcept;
-    ::std::vector<GraphData>& data() noexcept;
+    Graph(GraphExecutor&, const ::std::shared_ptr<const GraphPlan>&) noexcept;
+    AlignedVector<GraphVertex>& vertexes() noexcept;
+    AlignedVector<GraphData>& data() noexcept;
     // 以求解data为目的，对图进行推导
     // 1、对graph中对data的产出有直接或者间接依赖的vertex和data做求解标记
     //    无依赖vertex和已经ready的data视为推导终止节点
@@ -78,11 +102,22 @@ private:
     // 3、将产出具有活跃标记data的vertex记录在runnable_vertexes当中
     int32_t activate(Stack<GraphVertex*>& runnable_vertexes,
         ::std::vector<GraphData*>& data) noexcept;
+    // 优先复用上一次运行的closure，仍在使用中时再从executor创建
+    Closure create_closure() noexcept;
+    // data首次改变状态时调用，记入待重置链表，可并发调用
+    inline void touch(GraphData& data) noexcept;
 
     GraphExecutor* _executor {nullptr};
-    ::std::vector<GraphVertex> _vertexes;
-    ::std::vector<GraphData> _data;
-    ::std::unordered_map<::std::string, GraphData*> _data_by_name;
+    // 在多次运行间复用的closure
+    ClosureContext* _closure_context {nullptr};
+    // 运行的deadline，为steady_clock下的纳秒数，0表示不限制
+    int64_t _deadline_ns {0};
+    // 上次reset以来被触及的data组成的链表
+    ::std::atomic<GraphData*> _touched_data {nullptr};
+    // 名字和符号表等静态信息由同一个builder产出的实例共享
+    ::std::shared_ptr<const GraphPlan> _plan;
+    AlignedVector<GraphVertex> _vertexes;
+    AlignedVector<GraphData> _data;
     //graph级别context，graph运行期间不能进行context内容修改
     Any _context;
     //graph级别context，graph运行期间可以进行对context内容修改
@@ -103,14 +138,14 @@ class GraphLog {
                 _vertexes_p = &graph->vertexes();
             }
         }  
-        const ::std::vector<GraphVertex>* vertexes() const noexcept {
+        const AlignedVector<GraphVertex>* vertexes() const noexcept {
             return _vertexes_p;
         }
 
         friend ::std::ostream& operator<<(::std::ostream& out, const GraphLog& graph_log) noexcept;
 
     private:
-        ::std::vector<GraphVertex>* _vertexes_p {nullptr};
+        AlignedVector<GraphVertex>* _vertexes_p {nullptr};
 };
 
 
@@ -2,6 +2,7 @@
 #define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_GRAPH_HPP
 
 #include <joewu/graph/engine/graph.h>
+#include <joewu/graph/engine/data.h>
 #include <joewu/graph/engine/vertex.h>
 
 namespace joewu {
@@ -16,6 +17,32 @@ size_t Graph::vertex_size() const noexcept {
     return _vertexes.size();
 }
 
+template <typename ...D>
+int32_t Graph::invalidate(D... data) noexcept {
+    GraphData* root_data[] = {data...};
+    return invalidate(root_data, sizeof...(D));
+}
+
+void Graph::deadline(::std::chrono::steady_clock::time_point deadline) noexcept {
+    _deadline_ns = ::std::chrono::duration_cast<::std::chrono::nanoseconds>(
+        deadline.time_since_epoch()).count();
+}
+
+GraphData* Graph::find_data(const DataHandle& handle) noexcept {
+    if (unlikely(handle.index() >= _data.size())) {
+        return nullptr;
+    }
+    return &_data[handle.index()];
+}
+
+void Graph::touch(GraphData& data) noexcept {
+    GraphData* head = _touched_data.load(::std::memory_order_relaxed);
+    do {
+        data._next_touched_data = head;
+    } while (unlikely(!_touched_data.compare_exchange_weak(head, &data,
+                ::std::memory_order_release, ::std::memory_order_relaxed)));
+}
+
 template <typename ...D>
 Closure Graph::run(D... data) noexcept {
     GraphData* root_data[] = {data...};
@@ -0,0 +1,21 @@
+#include <joewu/graph/engine/graph_plan.h>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+GraphPlan::GraphPlan(size_t vertex_size,
+    const ::std::unordered_map<::std::string, size_t>& data_index_by_name,
+    ::std::vector<size_t>&& successor_num_by_data_index) noexcept :
+    _vertex_size(vertex_size), _data_names(data_index_by_name.size()),
+    _data_index_by_name(data_index_by_name),
+    _successor_num_by_data_index(::std::move(successor_num_by_data_index)) {
+    for (const auto& pair : _data_index_by_name) {
+        _data_names[pair.second] = pair.first;
+    }
+    _successor_num_by_data_index.resize(_data_names.size(), 0);
+}
+
+} // graph
+} // feed
+} // joewu
@@ -0,0 +1,49 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_GRAPH_PLAN_H
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_GRAPH_PLAN_H
+
+#include <joewu/graph/engine/expect.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+// GraphBuilder::finish时编译出的静态执行计划，构建完成后不可变
+// 记录data的名字、符号表和拓扑规模等只和图结构相关的信息
+// 由同一个builder产出的所有Graph实例共享，实例中只保留运行状态
+// 避免每个实例各自复制一份名字和符号表
+class GraphPlan {
+public:
+    GraphPlan(size_t vertex_size,
+        const ::std::unordered_map<::std::string, size_t>& data_index_by_name,
+        ::std::vector<size_t>&& successor_num_by_data_index) noexcept;
+
+    inline size_t vertex_size() const noexcept;
+    inline size_t data_size() const noexcept;
+    // 序号为index的data的名字
+    inline const ::std::string& data_name(size_t index) const noexcept;
+    // 查找名为name的data的序号，不存在时返回false
+    inline bool data_index(const ::std::string& name, size_t& index) const noexcept;
+    // 消费序号为index的data的依赖数，包括条件依赖，用于预分配空间
+    inline size_t successor_num(size_t index) const noexcept;
+
+private:
+    GraphPlan(const GraphPlan&) = delete;
+    GraphPlan& operator=(const GraphPlan&) = delete;
+
+    size_t _vertex_size {0};
+    ::std::vector<::std::string> _data_names;
+    ::std::unordered_map<::std::string, size_t> _data_index_by_name;
+    ::std::vector<size_t> _successor_num_by_data_index;
+};
+
+}  // graph
+}  // feed
+}  // joewu
+
+#endif // joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_GRAPH_PLAN_H
+
+#include <joewu/graph/engine/graph_plan.hpp>
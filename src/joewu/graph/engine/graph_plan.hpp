@@ -0,0 +1,38 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_GRAPH_PLAN_HPP
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_GRAPH_PLAN_HPP
+
+#include <joewu/graph/engine/graph_plan.h>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+size_t GraphPlan::vertex_size() const noexcept {
+    return _vertex_size;
+}
+
+size_t GraphPlan::data_size() const noexcept {
+    return _data_names.size();
+}
+
+const ::std::string& GraphPlan::data_name(size_t index) const noexcept {
+    return _data_names[index];
+}
+
+bool GraphPlan::data_index(const ::std::string& name, size_t& index) const noexcept {
+    auto it = _data_index_by_name.find(name);
+    if (unlikely(it == _data_index_by_name.end())) {
+        return false;
+    }
+    index = it->second;
+    return true;
+}
+
+size_t GraphPlan::successor_num(size_t index) const noexcept {
+    return _successor_num_by_data_index[index];
+}
+
+} // graph
+} // feed
+} // joewu
+#endif //joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_GRAPH_PLAN_HPP
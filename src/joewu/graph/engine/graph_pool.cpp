@@ -0,0 +1,291 @@
+#include <joewu/graph/engine/graph_pool.h>
+#include <joewu/graph/engine/builder.h>
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+////////////////////////////////////////////////////////////////////////////////
+// GraphPool::LocalSlot begin
+// 线程数通常不超过槽位数，各槽位的锁基本没有竞争
+class alignas(64) GraphPool::LocalSlot : public AlignedNew<LocalSlot> {
+private:
+    ::std::mutex _mutex;
+    ::std::vector<Graph*> _graphs;
+
+    friend class GraphPool;
+};
+// GraphPool::LocalSlot end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// GraphPool begin
+GraphPool::GraphPool(const GraphBuilder& builder, size_t capacity,
+    size_t local_capacity) noexcept :
+    _builder(&builder), _capacity(capacity), _local_capacity(local_capacity) {
+    size_t slot_num = ::std::max<size_t>(::std::thread::hardware_concurrency(), 1);
+    _local_slots.reserve(slot_num);
+    for (size_t i = 0; i < slot_num; ++i) {
+        _local_slots.emplace_back(new LocalSlot);
+        _local_slots.back()->_graphs.reserve(local_capacity);
+    }
+}
+
+GraphPool::~GraphPool() noexcept {
+    stop_background_reset();
+    for (auto& slot : _local_slots) {
+        for (auto graph : slot->_graphs) {
+            delete graph;
+        }
+    }
+    for (auto graph : _shared_graphs) {
+        delete graph;
+    }
+    for (auto graph : _resetting_graphs) {
+        delete graph;
+    }
+}
+
+PooledGraph GraphPool::acquire() noexcept {
+    Graph* graph = nullptr;
+    {
+        auto& slot = local_slot();
+        ::std::lock_guard<::std::mutex> lock(slot._mutex);
+        if (!slot._graphs.empty()) {
+            graph = slot._graphs.back();
+            slot._graphs.pop_back();
+        }
+    }
+    if (graph == nullptr) {
+        ::std::lock_guard<::std::mutex> lock(_shared_mutex);
+        if (!_shared_graphs.empty()) {
+            graph = _shared_graphs.back();
+            _shared_graphs.pop_back();
+        }
+    }
+    if (graph != nullptr) {
+        _hit_num.fetch_add(1, ::std::memory_order_relaxed);
+        return PooledGraph(graph, GraphPoolDeleter(this));
+    }
+    _miss_num.fetch_add(1, ::std::memory_order_relaxed);
+    graph = create();
+    if (graph == nullptr) {
+        // 达到上限时空闲实例可能缓存在其他线程的本地槽位中
+        graph = take_other_local();
+    }
+    if (graph == nullptr && _background_reset.load(::std::memory_order_acquire)) {
+        // 无法再创建时取回归还中的实例，尚未被后台取走的直接在当前线程reset
+        graph = take_resetting();
+    }
+    if (unlikely(graph == nullptr)) {
+        LOG(WARNING) << "graph pool[" << this << "] has no graph available with "
+            << created_num() << " created";
+    }
+    return PooledGraph(graph, GraphPoolDeleter(this));
+}
+
+size_t GraphPool::reserve(size_t num) noexcept {
+    size_t created = 0;
+    for (; created < num; ++created) {
+        auto graph = create();
+        if (graph == nullptr) {
+            break;
+        }
+        ::std::lock_guard<::std::mutex> lock(_shared_mutex);
+        _shared_graphs.emplace_back(graph);
+    }
+    return created;
+}
+
+void GraphPool::background_reset(bool enable) noexcept {
+    if (!enable) {
+        stop_background_reset();
+        return;
+    }
+    if (_background_reset.load(::std::memory_order_acquire)) {
+        return;
+    }
+    _reset_stopped = false;
+    _background_reset.store(true, ::std::memory_order_release);
+    _reset_thread = ::std::thread([this] {
+        reset_loop();
+    });
+}
+
+void GraphPool::release(Graph* graph) noexcept {
+    if (graph == nullptr) {
+        return;
+    }
+    if (!_background_reset.load(::std::memory_order_acquire)) {
+        graph->reset();
+        recycle(graph);
+        return;
+    }
+    bool queued = false;
+    bool need_notify = false;
+    {
+        ::std::lock_guard<::std::mutex> lock(_reset_mutex);
+        // 读到开启后后台reset可能被并发关闭，线程已经退出时不能再交给它
+        if (likely(!_reset_stopped)) {
+            // 后台线程处理完一批后才需要再次唤醒，积攒的实例一起处理
+            need_notify = _resetting_graphs.empty();
+            _resetting_graphs.emplace_back(graph);
+            queued = true;
+        }
+    }
+    if (!queued) {
+        graph->reset();
+        recycle(graph);
+        return;
+    }
+    if (need_notify) {
+        _reset_cond.notify_one();
+    }
+}
+
+void GraphPool::recycle(Graph* graph) noexcept {
+    {
+        auto& slot = local_slot();
+        ::std::lock_guard<::std::mutex> lock(slot._mutex);
+        if (slot._graphs.size() < _local_capacity) {
+            slot._graphs.emplace_back(graph);
+            return;
+        }
+    }
+    ::std::lock_guard<::std::mutex> lock(_shared_mutex);
+    _shared_graphs.emplace_back(graph);
+}
+
+Graph* GraphPool::create() noexcept {
+    // 先占用名额再创建，避免并发创建超出上限
+    auto created = _created_num.fetch_add(1, ::std::memory_order_relaxed);
+    if (_capacity > 0 && created >= _capacity) {
+        _created_num.fetch_sub(1, ::std::memory_order_relaxed);
+        return nullptr;
+    }
+    auto graph = _builder->build();
+    if (unlikely(!graph)) {
+        _created_num.fetch_sub(1, ::std::memory_order_relaxed);
+        LOG(WARNING) << "graph pool[" << this << "] build graph failed";
+        return nullptr;
+    }
+    return graph.release();
+}
+
+Graph* GraphPool::take_other_local() noexcept {
+    auto& own_slot = local_slot();
+    for (auto& slot : _local_slots) {
+        if (slot.get() == &own_slot) {
+            continue;
+        }
+        ::std::lock_guard<::std::mutex> lock(slot->_mutex);
+        if (!slot->_graphs.empty()) {
+            auto graph = slot->_graphs.back();
+            slot->_graphs.pop_back();
+            return graph;
+        }
+    }
+    return nullptr;
+}
+
+Graph* GraphPool::take_resetting() noexcept {
+    {
+        ::std::unique_lock<::std::mutex> lock(_reset_mutex);
+        while (_resetting_graphs.empty() && _inflight_num > 0) {
+            // 归还的实例都在后台线程手中，等这一批放回共享列表
+            _inflight_cond.wait(lock);
+        }
+        if (!_resetting_graphs.empty()) {
+            auto graph = _resetting_graphs.back();
+            _resetting_graphs.pop_back();
+            lock.unlock();
+            graph->reset();
+            return graph;
+        }
+    }
+    ::std::lock_guard<::std::mutex> lock(_shared_mutex);
+    if (_shared_graphs.empty()) {
+        return nullptr;
+    }
+    auto graph = _shared_graphs.back();
+    _shared_graphs.pop_back();
+    return graph;
+}
+
+void GraphPool::reset_loop() noexcept {
+    // 降低线程优先级，减少对请求线程的干扰
+    if (0 != ::setpriority(PRIO_PROCESS, ::syscall(SYS_gettid), 19)) {
+        LOG(WARNING) << "graph pool[" << this << "] lower reset thread priority failed";
+    }
+    ::std::vector<Graph*> graphs;
+    while (true) {
+        {
+            ::std::unique_lock<::std::mutex> lock(_reset_mutex);
+            while (!_reset_stopped && _resetting_graphs.empty()) {
+                _reset_cond.wait(lock);
+            }
+            // 停止时也先处理完积攒的实例
+            if (_resetting_graphs.empty()) {
+                return;
+            }
+            graphs.swap(_resetting_graphs);
+            _inflight_num = graphs.size();
+        }
+        for (auto graph : graphs) {
+            graph->reset();
+        }
+        {
+            ::std::lock_guard<::std::mutex> lock(_shared_mutex);
+            _shared_graphs.insert(_shared_graphs.end(), graphs.begin(), graphs.end());
+        }
+        graphs.clear();
+        {
+            ::std::lock_guard<::std::mutex> lock(_reset_mutex);
+            _inflight_num = 0;
+        }
+        _inflight_cond.notify_all();
+    }
+}
+
+void GraphPool::stop_background_reset() noexcept {
+    if (!_background_reset.load(::std::memory_order_acquire)) {
+        return;
+    }
+    {
+        ::std::lock_guard<::std::mutex> lock(_reset_mutex);
+        _reset_stopped = true;
+    }
+    _reset_cond.notify_all();
+    _reset_thread.join();
+    _background_reset.store(false, ::std::memory_order_release);
+    // 后台线程退出后仍可能有归还的实例，就地reset后放回
+    ::std::vector<Graph*> graphs;
+    {
+        ::std::lock_guard<::std::mutex> lock(_reset_mutex);
+        graphs.swap(_resetting_graphs);
+    }
+    for (auto graph : graphs) {
+        graph->reset();
+        recycle(graph);
+    }
+}
+
+GraphPool::LocalSlot& GraphPool::local_slot() noexcept {
+    // 线程首次使用时轮流分配槽位，之后固定
+    static ::std::atomic<size_t> next_index {0};
+    static thread_local size_t index = next_index.fetch_add(1, ::std::memory_order_relaxed);
+    return *_local_slots[index % _local_slots.size()];
+}
+// GraphPool end
+////////////////////////////////////////////////////////////////////////////////
+
+} // graph
+} // feed
+} // joewu
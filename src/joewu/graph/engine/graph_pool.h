@@ -0,0 +1,113 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_GRAPH_POOL_H
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_GRAPH_POOL_H
+
+#include <joewu/graph/engine/expect.h>
+#include <joewu/graph/engine/graph.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+class GraphPool;
+// 归还到GraphPool而不是销毁
+class GraphPoolDeleter {
+public:
+    GraphPoolDeleter() noexcept = default;
+    inline GraphPoolDeleter(GraphPool* pool) noexcept;
+    inline void operator()(Graph* graph) const noexcept;
+
+private:
+    GraphPool* _pool {nullptr};
+};
+typedef ::std::unique_ptr<Graph, GraphPoolDeleter> PooledGraph;
+
+class GraphBuilder;
+// 同一个GraphBuilder产出的Graph实例池，避免在请求路径上build
+// 按线程分散到多个本地槽位，槽位已满时溢出到共享列表
+// 同一线程倾向于取回自己归还的实例，保持缓存热度
+// 实例在归还时reset，需要确保此时其上的运行已经进入稳态
+// builder和pool需要比取出的所有实例存活更久
+class GraphPool {
+public:
+    // capacity为最多创建的实例数，0表示不限制
+    // local_capacity为每个本地槽位最多缓存的实例数
+    GraphPool(const GraphBuilder& builder, size_t capacity = 0,
+        size_t local_capacity = 4) noexcept;
+    GraphPool(const GraphPool&) = delete;
+    ~GraphPool() noexcept;
+
+    // 取出一个可用实例，没有空闲实例时创建新的
+    // 达到capacity时从其他线程的本地槽位取用空闲实例
+    // 仍然没有可用实例或者创建失败时返回空
+    PooledGraph acquire() noexcept;
+    // 预先创建num个实例放入共享列表，返回实际创建的个数
+    size_t reserve(size_t num) noexcept;
+    // 开启后台reset，需要在使用前设置
+    // 归还的实例交给低优先级的后台线程批量reset，完成后才会再次取出
+    // 没有空闲实例且达到上限时，取出一个待reset的实例就地reset
+    // 待reset的实例都已经被后台线程取走时，等待这一批完成后再取
+    void background_reset(bool enable = true) noexcept;
+
+    // 从缓存取到实例的次数
+    inline size_t hit_num() const noexcept;
+    // 没有空闲实例的次数，包括新建以及达到上限
+    inline size_t miss_num() const noexcept;
+    // 已经创建的实例数
+    inline size_t created_num() const noexcept;
+
+private:
+    class LocalSlot;
+
+    // 归还实例，reset之后放回
+    void release(Graph* graph) noexcept;
+    // 放回已经reset的实例
+    void recycle(Graph* graph) noexcept;
+    // 达到上限或者创建失败时返回nullptr
+    Graph* create() noexcept;
+    // 从其他线程的本地槽位取出一个空闲实例，都为空时返回nullptr
+    Graph* take_other_local() noexcept;
+    // 取出一个待reset的实例并就地reset，后台线程正在处理时等待其完成
+    // 没有任何归还中的实例时返回nullptr
+    Graph* take_resetting() noexcept;
+    LocalSlot& local_slot() noexcept;
+    // 后台线程，批量reset并放回共享列表
+    void reset_loop() noexcept;
+    void stop_background_reset() noexcept;
+
+    const GraphBuilder* _builder;
+    size_t _capacity;
+    size_t _local_capacity;
+    ::std::vector<::std::unique_ptr<LocalSlot>> _local_slots;
+    ::std::mutex _shared_mutex;
+    ::std::vector<Graph*> _shared_graphs;
+    ::std::atomic<size_t> _hit_num {0};
+    ::std::atomic<size_t> _miss_num {0};
+    ::std::atomic<size_t> _created_num {0};
+
+    // 后台reset
+    ::std::thread _reset_thread;
+    ::std::mutex _reset_mutex;
+    ::std::condition_variable _reset_cond;
+    ::std::vector<Graph*> _resetting_graphs;
+    // 后台线程已经取走但还没有放回共享列表的实例数，由_reset_mutex保护
+    size_t _inflight_num {0};
+    ::std::condition_variable _inflight_cond;
+    ::std::atomic<bool> _background_reset {false};
+    bool _reset_stopped {false};
+
+    friend class GraphPoolDeleter;
+};
+
+} // graph
+} // feed
+} // joewu
+#endif //joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_GRAPH_POOL_H
+
+#include <joewu/graph/engine/graph_pool.hpp>
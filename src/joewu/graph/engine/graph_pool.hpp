@@ -0,0 +1,39 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_GRAPH_POOL_HPP
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_GRAPH_POOL_HPP
+
+#include <joewu/graph/engine/graph_pool.h>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+///////////////////////////////////////////////////////////////////////////////
+// GraphPoolDeleter begin
+GraphPoolDeleter::GraphPoolDeleter(GraphPool* pool) noexcept : _pool(pool) {}
+
+void GraphPoolDeleter::operator()(Graph* graph) const noexcept {
+    _pool->release(graph);
+}
+// GraphPoolDeleter end
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// GraphPool begin
+size_t GraphPool::hit_num() const noexcept {
+    return _hit_num.load(::std::memory_order_relaxed);
+}
+
+size_t GraphPool::miss_num() const noexcept {
+    return _miss_num.load(::std::memory_order_relaxed);
+}
+
+size_t GraphPool::created_num() const noexcept {
+    return _created_num.load(::std::memory_order_relaxed);
+}
+// GraphPool end
+///////////////////////////////////////////////////////////////////////////////
+
+} // graph
+} // feed
+} // joewu
+#endif //joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_GRAPH_POOL_HPP
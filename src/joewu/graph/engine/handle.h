@@ -0,0 +1,69 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_HANDLE_H
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_HANDLE_H
+
+#include <cstddef>
+#include <limits>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+// 预先按名字或序号解析好的位置，运行期访问只需要一次下标读取
+// 只和图结构相关，同一个builder产出的所有Graph实例间通用
+// 因此可以保存在共享的processor或者option中
+// 默认构造的句柄无效，通过句柄访问时返回nullptr
+
+// Graph中的data，由GraphBuilder::data_handle在finish后解析
+class DataHandle {
+public:
+    inline DataHandle() noexcept = default;
+    inline explicit operator bool() const noexcept;
+    inline size_t index() const noexcept;
+
+private:
+    inline explicit DataHandle(size_t index) noexcept;
+
+    size_t _index {::std::numeric_limits<size_t>::max()};
+
+    friend class GraphBuilder;
+};
+
+// vertex的依赖，由GraphVertex::named_dependency_handle等在setup时解析
+// T为依赖的数据类型，用于GraphVertex::value直接取得类型化的值
+template <typename T>
+class DependencyHandle {
+public:
+    inline DependencyHandle() noexcept = default;
+    inline explicit operator bool() const noexcept;
+    inline size_t index() const noexcept;
+
+private:
+    inline explicit DependencyHandle(size_t index) noexcept;
+
+    size_t _index {::std::numeric_limits<size_t>::max()};
+
+    friend class GraphVertex;
+};
+
+// vertex的输出，由GraphVertex::named_emit_handle等在setup时解析
+class EmitHandle {
+public:
+    inline EmitHandle() noexcept = default;
+    inline explicit operator bool() const noexcept;
+    inline size_t index() const noexcept;
+
+private:
+    inline explicit EmitHandle(size_t index) noexcept;
+
+    size_t _index {::std::numeric_limits<size_t>::max()};
+
+    friend class GraphVertex;
+};
+
+}  // graph
+}  // feed
+}  // joewu
+
+#endif // joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_HANDLE_H
+
+#include <joewu/graph/engine/handle.hpp>
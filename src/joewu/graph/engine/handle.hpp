@@ -0,0 +1,58 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_HANDLE_HPP
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_HANDLE_HPP
+
+#include <joewu/graph/engine/handle.h>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+///////////////////////////////////////////////////////////////////////////////
+// DataHandle begin
+DataHandle::DataHandle(size_t index) noexcept : _index(index) {}
+
+DataHandle::operator bool() const noexcept {
+    return _index != ::std::numeric_limits<size_t>::max();
+}
+
+size_t DataHandle::index() const noexcept {
+    return _index;
+}
+// DataHandle end
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// DependencyHandle begin
+template <typename T>
+DependencyHandle<T>::DependencyHandle(size_t index) noexcept : _index(index) {}
+
+template <typename T>
+DependencyHandle<T>::operator bool() const noexcept {
+    return _index != ::std::numeric_limits<size_t>::max();
+}
+
+template <typename T>
+size_t DependencyHandle<T>::index() const noexcept {
+    return _index;
+}
+// DependencyHandle end
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// EmitHandle begin
+EmitHandle::EmitHandle(size_t index) noexcept : _index(index) {}
+
+EmitHandle::operator bool() const noexcept {
+    return _index != ::std::numeric_limits<size_t>::max();
+}
+
+size_t EmitHandle::index() const noexcept {
+    return _index;
+}
+// EmitHandle end
+///////////////////////////////////////////////////////////////////////////////
+
+} // graph
+} // feed
+} // joewu
+#endif //joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_HANDLE_HPP
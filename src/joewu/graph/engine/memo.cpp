@@ -0,0 +1,126 @@
+#include <joewu/graph/engine/memo.h>
+
+#include <algorithm>
+#include <string>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+GraphVertexMemo::GraphVertexMemo(size_t capacity, ::std::chrono::nanoseconds ttl,
+    const GraphMemoHasher& hasher, const GraphMemoEqual& equal) noexcept :
+    _shard_num(::std::max<size_t>(1, ::std::min(capacity, SHARD_NUM))),
+    _ttl(ttl), _hasher(hasher), _equal(equal) {
+    if (!_hasher) {
+        _hasher = default_hash;
+        _equal = default_equal;
+    }
+    // 余数分给靠前的分片，保证全部分片容量之和不超过capacity
+    capacity = ::std::max<size_t>(1, capacity);
+    for (size_t i = 0; i < _shard_num; ++i) {
+        _shards[i].capacity = capacity / _shard_num + (i < capacity % _shard_num ? 1 : 0);
+    }
+}
+
+::std::shared_ptr<const GraphVertexMemo::Entry> GraphVertexMemo::find(uint64_t key) noexcept {
+    ::std::shared_ptr<const Entry> entry;
+    {
+        auto& one_shard = shard(key);
+        ::std::lock_guard<::std::mutex> lock(one_shard.mutex);
+        auto iter = one_shard.entries.find(key);
+        if (iter != one_shard.entries.end()) {
+            entry = iter->second;
+        }
+    }
+    // 过期的条目留在原位，等待下次insert覆盖或者被淘汰
+    if (entry == nullptr || entry->expire < ::std::chrono::steady_clock::now()) {
+        _miss_num.fetch_add(1, ::std::memory_order_relaxed);
+        return ::std::shared_ptr<const Entry>();
+    }
+    _hit_num.fetch_add(1, ::std::memory_order_relaxed);
+    return entry;
+}
+
+void GraphVertexMemo::insert(uint64_t key, ::std::shared_ptr<Entry>&& entry) noexcept {
+    if (_ttl.count() > 0) {
+        entry->expire = ::std::chrono::steady_clock::now() + _ttl;
+    } else {
+        entry->expire = ::std::chrono::steady_clock::time_point::max();
+    }
+    // 被淘汰的条目在锁外释放
+    ::std::shared_ptr<const Entry> evicted;
+    auto& one_shard = shard(key);
+    ::std::lock_guard<::std::mutex> lock(one_shard.mutex);
+    auto result = one_shard.entries.emplace(key, nullptr);
+    evicted.swap(result.first->second);
+    result.first->second = ::std::move(entry);
+    if (!result.second) {
+        return;
+    }
+    one_shard.keys.emplace_back(key);
+    if (one_shard.keys.size() > one_shard.capacity) {
+        auto iter = one_shard.entries.find(one_shard.keys.front());
+        evicted.swap(iter->second);
+        one_shard.entries.erase(iter);
+        one_shard.keys.pop_front();
+    }
+}
+
+size_t GraphVertexMemo::size() const noexcept {
+    size_t size = 0;
+    for (auto& one_shard : _shards) {
+        ::std::lock_guard<::std::mutex> lock(one_shard.mutex);
+        size += one_shard.entries.size();
+    }
+    return size;
+}
+
+bool GraphVertexMemo::default_hash(const Any& value, uint64_t& hash) noexcept {
+#define __GRAPH_MEMO_HASH(type) \
+    if (value.cget<type>() != nullptr) { \
+        hash = ::std::hash<type>()(*value.cget<type>()); \
+        return true; \
+    }
+    __GRAPH_MEMO_HASH(bool)
+    __GRAPH_MEMO_HASH(int8_t)
+    __GRAPH_MEMO_HASH(int16_t)
+    __GRAPH_MEMO_HASH(int32_t)
+    __GRAPH_MEMO_HASH(int64_t)
+    __GRAPH_MEMO_HASH(uint8_t)
+    __GRAPH_MEMO_HASH(uint16_t)
+    __GRAPH_MEMO_HASH(uint32_t)
+    __GRAPH_MEMO_HASH(uint64_t)
+    __GRAPH_MEMO_HASH(float)
+    __GRAPH_MEMO_HASH(double)
+    __GRAPH_MEMO_HASH(::std::string)
+#undef __GRAPH_MEMO_HASH
+    return false;
+}
+
+bool GraphVertexMemo::default_equal(const Any& left, const Any& right) noexcept {
+#define __GRAPH_MEMO_EQUAL(type) \
+    if (left.cget<type>() != nullptr) { \
+        return right.cget<type>() != nullptr && *left.cget<type>() == *right.cget<type>(); \
+    }
+    __GRAPH_MEMO_EQUAL(bool)
+    __GRAPH_MEMO_EQUAL(int8_t)
+    __GRAPH_MEMO_EQUAL(int16_t)
+    __GRAPH_MEMO_EQUAL(int32_t)
+    __GRAPH_MEMO_EQUAL(int64_t)
+    __GRAPH_MEMO_EQUAL(uint8_t)
+    __GRAPH_MEMO_EQUAL(uint16_t)
+    __GRAPH_MEMO_EQUAL(uint32_t)
+    __GRAPH_MEMO_EQUAL(uint64_t)
+    __GRAPH_MEMO_EQUAL(float)
+    __GRAPH_MEMO_EQUAL(double)
+    __GRAPH_MEMO_EQUAL(::std::string)
+#undef __GRAPH_MEMO_EQUAL
+    return false;
+}
+
+constexpr size_t GraphVertexMemo::SHARD_NUM;
+constexpr uint64_t GraphVertexMemo::EMPTY_HASH;
+
+} // graph
+} // feed
+} // joewu
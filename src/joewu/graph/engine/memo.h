@@ -0,0 +1,102 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_MEMO_H
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_MEMO_H
+
+#include <joewu/graph/engine/aligned.h>
+#include <joewu/graph/engine/expect.h>
+
+#include <joewu/feed/mlarch/babylon/any.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+using ::joewu::feed::mlarch::babylon::Any;
+
+// 计算单个依赖值的hash，返回false表示无法hash，本次运行不使用缓存
+using GraphMemoHasher = ::std::function<bool(const Any&, uint64_t&)>;
+// 判断两个同类型的依赖值是否相等，用于命中时排除hash冲突
+using GraphMemoEqual = ::std::function<bool(const Any&, const Any&)>;
+
+// 节点产出的跨请求缓存，由GraphVertexBuilder持有，同一builder产出的Graph实例共享
+// 用于产出只由依赖的值决定的节点，以全部依赖值及其类型的hash为key记录各个emit的值
+// 命中时直接发布缓存的值，不再运行process
+// 有equal时条目同时保存依赖值的副本，命中后逐个比较，hash冲突时视为未命中
+// 自定义hasher而没有提供equal时无法校验，需要hasher自身保证没有冲突
+class GraphVertexMemo : public AlignedNew<GraphVertexMemo> {
+public:
+    // 最大分片数，每个分片独立加锁，锁内只做查找和引用计数操作
+    static constexpr size_t SHARD_NUM = 16;
+
+    // 一次运行的全部产出，插入后不可变
+    struct Entry {
+        ::std::vector<Any> values;
+        ::std::vector<bool> empty;
+        // 产生这份产出的依赖值，没有equal时不保存
+        ::std::vector<Any> dependencies;
+        ::std::vector<bool> dependency_empty;
+        ::std::chrono::steady_clock::time_point expire;
+    };
+
+    // 最多缓存capacity个条目，capacity小于SHARD_NUM时相应减少分片
+    // 容量在各个分片间分配，总和恰好为capacity，分片满时淘汰最早插入的条目
+    // ttl为0时条目不过期，没有设置hasher时使用default_hash和default_equal
+    GraphVertexMemo(size_t capacity, ::std::chrono::nanoseconds ttl,
+        const GraphMemoHasher& hasher, const GraphMemoEqual& equal) noexcept;
+    // 将一个依赖值并入key，value为nullptr表示依赖未就绪或为空
+    inline bool combine(uint64_t& key, const Any* value) const noexcept;
+    // 命中时是否需要保存和比较依赖值
+    inline bool verifiable() const noexcept;
+    // 第index个依赖值是否和条目中保存的相同，value为nullptr表示依赖未就绪或为空
+    inline bool same(const Entry& entry, size_t index, const Any* value) const noexcept;
+    // 查找未过期的条目，不存在时返回空
+    ::std::shared_ptr<const Entry> find(uint64_t key) noexcept;
+    // 记录一次运行的产出，已经存在时覆盖
+    void insert(uint64_t key, ::std::shared_ptr<Entry>&& entry) noexcept;
+    // 当前条目数
+    size_t size() const noexcept;
+    // 命中和未命中次数
+    inline size_t hit_num() const noexcept;
+    inline size_t miss_num() const noexcept;
+
+    // 默认的hasher和equal，支持基础数值类型和::std::string
+    static bool default_hash(const Any& value, uint64_t& hash) noexcept;
+    static bool default_equal(const Any& left, const Any& right) noexcept;
+
+private:
+    // 空依赖并入key时使用的hash，和任何值的hash区分开
+    static constexpr uint64_t EMPTY_HASH = 0x5bd1e9955bd1e995ULL;
+
+    struct alignas(64) Shard {
+        mutable ::std::mutex mutex;
+        ::std::unordered_map<uint64_t, ::std::shared_ptr<const Entry>> entries;
+        // 按插入顺序记录key，用于淘汰
+        ::std::deque<uint64_t> keys;
+        size_t capacity {0};
+    };
+
+    inline Shard& shard(uint64_t key) noexcept;
+
+    size_t _shard_num;
+    ::std::chrono::nanoseconds _ttl;
+    GraphMemoHasher _hasher;
+    GraphMemoEqual _equal;
+    Shard _shards[SHARD_NUM];
+    ::std::atomic<size_t> _hit_num {0};
+    ::std::atomic<size_t> _miss_num {0};
+};
+
+}  // graph
+}  // feed
+}  // joewu
+
+#endif // joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_MEMO_H
+
+#include <joewu/graph/engine/memo.hpp>
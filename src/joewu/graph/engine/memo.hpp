@@ -0,0 +1,53 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_MEMO_HPP
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_MEMO_HPP
+
+#include <joewu/graph/engine/memo.h>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+bool GraphVertexMemo::combine(uint64_t& key, const Any* value) const noexcept {
+    uint64_t hash = EMPTY_HASH;
+    if (value != nullptr) {
+        if (!_hasher(*value, hash)) {
+            return false;
+        }
+        // 类型标识是进程内唯一的静态对象，并入地址区分hash相同的不同类型
+        auto type = reinterpret_cast<uintptr_t>(&value->instance_type());
+        hash ^= type + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    }
+    key ^= hash + 0x9e3779b97f4a7c15ULL + (key << 6) + (key >> 2);
+    return true;
+}
+
+bool GraphVertexMemo::verifiable() const noexcept {
+    return static_cast<bool>(_equal);
+}
+
+bool GraphVertexMemo::same(const Entry& entry, size_t index,
+    const Any* value) const noexcept {
+    if (value == nullptr || entry.dependency_empty[index]) {
+        return value == nullptr && entry.dependency_empty[index];
+    }
+    auto& stored = entry.dependencies[index];
+    return &value->instance_type() == &stored.instance_type() && _equal(*value, stored);
+}
+
+size_t GraphVertexMemo::hit_num() const noexcept {
+    return _hit_num.load(::std::memory_order_relaxed);
+}
+
+size_t GraphVertexMemo::miss_num() const noexcept {
+    return _miss_num.load(::std::memory_order_relaxed);
+}
+
+GraphVertexMemo::Shard& GraphVertexMemo::shard(uint64_t key) noexcept {
+    return _shards[(key >> 32) % _shard_num];
+}
+
+}  // graph
+}  // feed
+}  // joewu
+
+#endif // joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_MEMO_HPP
@@ -0,0 +1,134 @@
+#include <joewu/graph/engine/serial_executor.h>
+#include <joewu/graph/engine/closure.h>
+#include <joewu/graph/engine/vertex.h>
+
+#include <tuple>
+#include <vector>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+////////////////////////////////////////////////////////////////////////////////
+// SerialGraphExecutor::Drain begin
+// 一次图运行在当前线程上的待运行队列
+class SerialGraphExecutor::Drain {
+public:
+    inline Drain(ClosureContext* closure) noexcept : _closure(closure) {}
+
+    // 当前线程上正在清空的队列
+    static Drain*& current() noexcept {
+        static thread_local Drain* drain = nullptr;
+        return drain;
+    }
+
+    inline ClosureContext* closure() const noexcept {
+        return _closure;
+    }
+
+    inline void add(GraphVertex* vertex, GraphVertexClosure&& closure) noexcept {
+        _vertexes.emplace_back(vertex, ::std::move(closure));
+    }
+
+    inline void add(ClosureCallback* callback) noexcept {
+        _callbacks.emplace_back(callback);
+    }
+
+    // 按加入顺序运行节点，节点全部结束后再运行回调
+    void run() noexcept {
+        auto& current = Drain::current();
+        auto previous = current;
+        current = this;
+        while (true) {
+            if (_head < _vertexes.size()) {
+                // 运行过程中会继续加入节点，先移出避免引用失效
+                auto& task = _vertexes[_head++];
+                auto vertex = ::std::get<0>(task);
+                GraphVertexClosure closure(::std::move(::std::get<1>(task)));
+                run_vertex(vertex, ::std::move(closure));
+                continue;
+            }
+            if (!_callbacks.empty()) {
+                auto callback = _callbacks.back();
+                _callbacks.pop_back();
+                // 回调结束时closure随之销毁，之后不再接收属于它的任务
+                auto closure = _closure;
+                _closure = nullptr;
+                closure->run(callback);
+                continue;
+            }
+            break;
+        }
+        current = previous;
+    }
+
+private:
+    ClosureContext* _closure;
+    ::std::vector<::std::tuple<GraphVertex*, GraphVertexClosure>> _vertexes;
+    size_t _head {0};
+    ::std::vector<ClosureCallback*> _callbacks;
+};
+// SerialGraphExecutor::Drain end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// SerialGraphExecutor begin
+Closure SerialGraphExecutor::create_closure() noexcept {
+    return Closure::create_atomic<FutexWaiter>(*this);
+}
+
+int32_t SerialGraphExecutor::run(GraphVertex* vertex,
+    GraphVertexClosure&& closure) noexcept {
+    auto context = closure_of(vertex);
+    auto drain = Drain::current();
+    if (drain != nullptr && drain->closure() == context) {
+        drain->add(vertex, ::std::move(closure));
+        return 0;
+    }
+    Drain new_drain(context);
+    new_drain.add(vertex, ::std::move(closure));
+    new_drain.run();
+    return 0;
+}
+
+int32_t SerialGraphExecutor::run(GraphVertex* vertexes[], size_t size) noexcept {
+    if (size == 0) {
+        return 0;
+    }
+    auto context = closure_of(vertexes[0]);
+    auto drain = Drain::current();
+    if (drain != nullptr && drain->closure() == context) {
+        for (size_t i = 0; i < size; ++i) {
+            drain->add(vertexes[i], create_vertex_closure(vertexes[i]));
+        }
+        return 0;
+    }
+    Drain new_drain(context);
+    for (size_t i = 0; i < size; ++i) {
+        new_drain.add(vertexes[i], create_vertex_closure(vertexes[i]));
+    }
+    new_drain.run();
+    return 0;
+}
+
+int32_t SerialGraphExecutor::run(ClosureContext* closure,
+    ClosureCallback* callback) noexcept {
+    auto drain = Drain::current();
+    if (drain != nullptr && drain->closure() == closure) {
+        drain->add(callback);
+        return 0;
+    }
+    closure->run(callback);
+    return 0;
+}
+
+int32_t SerialGraphExecutor::run(::std::function<void()>&& function) noexcept {
+    function();
+    return 0;
+}
+// SerialGraphExecutor end
+////////////////////////////////////////////////////////////////////////////////
+
+} // graph
+} // feed
+} // joewu
@@ -0,0 +1,43 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_SERIAL_EXECUTOR_H
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_SERIAL_EXECUTOR_H
+
+#include <joewu/graph/engine/expect.h>
+#include <joewu/graph/engine/executor.h>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+// 在调用线程上以run-to-completion方式运行整个图的执行器
+// 适用于小图和离线批处理等场景，没有调度开销也不需要线程间同步
+// Graph::run返回时，只要没有算子把数据交给其他线程异步产出，closure就已经结束
+//
+// 节点不直接递归运行，而是进入当前线程上这次图运行的待运行队列
+// 由最外层依次取出运行，栈深度与图的深度无关，顺序即拓扑序
+// closure在队列运行期间结束时，on_finish等回调留在队列末尾，等已入队的节点运行完再执行
+// 队列只负责推迟回调，不会为回调等待任何节点
+// closure在队列之外结束时（典型如算子把数据交给其他线程异步产出，或Graph::run返回后才注册回调）
+// 回调直接在结束或注册的线程上运行，此时仍有节点在其他线程运行的话，回调中wait会阻塞到其结束
+// 算子中同步运行另一个图时，会按closure区分开启一个新的队列，不会互相等待
+class SerialGraphExecutor : public GraphExecutor {
+public:
+    static SerialGraphExecutor& instance() {
+        static SerialGraphExecutor executor;
+        return executor;
+    }
+    virtual Closure create_closure() noexcept override;
+    virtual int32_t run(GraphVertex* vertex,
+        GraphVertexClosure&& closure) noexcept override;
+    virtual int32_t run(ClosureContext* closure, ::std::function<void(Closure&&)>* callback) noexcept override;
+    virtual int32_t run(GraphVertex* vertexes[], size_t size) noexcept override;
+    // 普通函数直接在调用线程运行
+    virtual int32_t run(::std::function<void()>&& function) noexcept override;
+
+private:
+    class Drain;
+};
+
+} // graph
+} // feed
+} // joewu
+#endif //joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_SERIAL_EXECUTOR_H
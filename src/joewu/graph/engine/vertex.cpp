@@ -2,6 +2,8 @@
 #include <joewu/graph/engine/executor.h>
 #include <joewu/graph/engine/expect.h>
 
+#include <algorithm>
+
 namespace joewu {
 namespace feed {
 namespace graph {
@@ -83,6 +85,36 @@ void GraphFunction::reset() noexcept {
 // GraphFunction end
 ////////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////////////
+// GraphVertexCost begin
+uint64_t GraphVertexCost::p90() const noexcept {
+    uint64_t samples[WINDOW_SIZE];
+    for (size_t i = 0; i < WINDOW_SIZE; ++i) {
+        samples[i] = _samples[i].load(::std::memory_order_relaxed);
+    }
+    ::std::nth_element(samples, samples + P90_INDEX, samples + WINDOW_SIZE);
+    return samples[P90_INDEX];
+}
+
+void GraphVertexCost::evaluate() noexcept {
+    // 按计数判断p90所在的区间，不需要排序
+    static constexpr int64_t TAIL_NUM = WINDOW_SIZE - P90_INDEX;
+    if (_asynchronous.load(::std::memory_order_relaxed)) {
+        return;
+    }
+    if (_slow_num.load(::std::memory_order_relaxed) < TAIL_NUM) {
+        _cheap.store(true, ::std::memory_order_relaxed);
+    } else if (_demote_num.load(::std::memory_order_relaxed) >= TAIL_NUM) {
+        _cheap.store(false, ::std::memory_order_relaxed);
+    }
+}
+
+constexpr size_t GraphVertexCost::WINDOW_SIZE;
+constexpr uint64_t GraphVertexCost::DEMOTE_RATIO;
+constexpr size_t GraphVertexCost::P90_INDEX;
+// GraphVertexCost end
+////////////////////////////////////////////////////////////////////////////////
+
 ///////////////////////////////////////////////////////////////////////////////
 // GraphVertex begin
 int32_t GraphVertex::activate(Stack<GraphData*>& activating_data,
@@ -136,7 +168,202 @@ int32_t GraphVertex::activate(Stack<GraphData*>& activating_data,
     return 0;
 }
 
+void GraphVertex::invoke_all(Stack<GraphVertex*>& runnable_vertexes,
+    GraphVertex* producer) noexcept {
+    // 分两阶段清空可运行节点
+    // 先把非平凡节点攒成批次交给executor，让耗时的异步节点尽早开始
+    // 再在当前线程串行运行平凡节点，其产出的新节点进入下一轮
+    BABYLON_STACK(GraphVertex*, batch, runnable_vertexes.capacity());
+    BABYLON_STACK(GraphVertex*, inplace, runnable_vertexes.capacity());
+    while (true) {
+        while (!runnable_vertexes.empty()) {
+            auto vertex = runnable_vertexes.back();
+            runnable_vertexes.pop_back();
+            if (vertex->inplace() || vertex->skippable()) {
+                inplace.emplace_back(vertex);
+            } else {
+                batch.emplace_back(vertex);
+            }
+        }
+        // 按优先级从高到低排列，关键路径上的节点先调度
+        ::std::sort(&batch[0], &batch[0] + batch.size(), [] (GraphVertex* left, GraphVertex* right) {
+            return left->_priority > right->_priority;
+        });
+        // 优先级最高且可以续体执行的节点暂存到producer上，等其process返回后在当前线程运行
+        // 续体在此时创建闭包，保证producer结束后graph仍然存活
+        if (producer != nullptr) {
+            for (size_t i = 0; i < batch.size(); ++i) {
+                if (producer->can_continue_with(*batch[i])) {
+                    auto continuation = batch[i];
+                    ::std::copy(&batch[0] + i + 1, &batch[0] + batch.size(), &batch[0] + i);
+                    batch.pop_back();
+                    // 续体继承producer的栈起点，深度加一，超出限制后退回executor调度
+                    continuation->_continuation_depth = producer->_continuation_depth + 1;
+                    continuation->_stack_base = producer->_stack_base;
+                    continuation->_stashed_closure =
+                        GraphVertexClosure(*continuation->_closure, *continuation);
+                    *producer->_continuation_slot = continuation;
+                    break;
+                }
+            }
+        }
+        run_batch(batch);
+        for (size_t i = 0; i < inplace.size(); ++i) {
+            inplace[i]->invoke(runnable_vertexes);
+        }
+        inplace.clear();
+        if (runnable_vertexes.empty()) {
+            break;
+        }
+    }
+}
+
+void GraphVertex::run_batch(Stack<GraphVertex*>& vertexes) noexcept {
+    // 按executor分组提交，组内保持优先级顺序
+    // 一个图中executor种类很少，直接多趟扫描，已提交的位置置空
+    auto size = vertexes.size();
+    BABYLON_STACK(GraphVertex*, group, size);
+    for (size_t i = 0; i < size; ++i) {
+        if (vertexes[i] == nullptr) {
+            continue;
+        }
+        auto executor = vertexes[i]->_executor;
+        for (size_t j = i; j < size; ++j) {
+            if (vertexes[j] != nullptr && vertexes[j]->_executor == executor) {
+                group.emplace_back(vertexes[j]);
+                vertexes[j] = nullptr;
+            }
+        }
+        LOG(TRACE) << "invoke " << group.size() << " vertexes from " << *group[0];
+        if (unlikely(0 != executor->run(&group[0], group.size()))) {
+            LOG(WARNING) << "run " << group.size() << " vertexes from " << *group[0]
+                << " partially failed";
+        }
+        group.clear();
+    }
+    vertexes.clear();
+}
+
+void GraphVertex::analyze_sheddable() noexcept {
+    // 没有消费者的节点产出的是图的结果，作为条件或被必要依赖消费的节点决定后续是否运行
+    // 只有被非必要依赖消费的节点，跳过后消费者仍然可以用已就绪的部分继续运行
+    // 任一产出没有消费者都不能舍弃，其他产出有消费者也不行
+    bool consumed = false;
+    for (auto data : _emits) {
+        if (data->_successors.empty()) {
+            _sheddable = false;
+            return;
+        }
+        for (auto dependency : data->_successors) {
+            if (dependency->inner_condition() == data || dependency->is_essential()) {
+                _sheddable = false;
+                return;
+            }
+            consumed = true;
+        }
+    }
+    _sheddable = consumed;
+}
+
+void GraphVertex::analyze_memo() noexcept {
+    if (_memo == nullptr) {
+        return;
+    }
+    // 缓存的产出以常量引用发布，可变依赖无法修改，也不能让运行中的修改污染缓存
+    for (auto data : _emits) {
+        for (auto dependency : data->_successors) {
+            if (dependency->is_mutable()) {
+                LOG(WARNING) << *this << " disable memo for " << *data
+                    << " is mutable depended by " << *dependency->_source;
+                _memo = nullptr;
+                return;
+            }
+        }
+    }
+}
+
+bool GraphVertex::memo_hit() noexcept {
+    uint64_t key = 0;
+    for (auto& dependency : _dependencies) {
+        if (!_memo->combine(key, dependency.value<Any>())) {
+            LOG(TRACE) << *this << " skip memo for unhashable dependency";
+            return false;
+        }
+    }
+    auto entry = _memo->find(key);
+    if (entry != nullptr && _memo->verifiable()) {
+        // 逐个比较依赖值，hash冲突时按未命中处理，运行后覆盖冲突的条目
+        for (size_t i = 0; i < _dependencies.size(); ++i) {
+            if (!_memo->same(*entry, i, _dependencies[i].value<Any>())) {
+                LOG(TRACE) << *this << " memo key collision";
+                entry.reset();
+                break;
+            }
+        }
+    }
+    if (entry == nullptr) {
+        _memo_key = key;
+        _memo_pending = true;
+        return false;
+    }
+    _memo_entry = ::std::move(entry);
+    for (size_t i = 0; i < _emits.size(); ++i) {
+        auto commiter = _emits[i]->emit<Any>();
+        if (!_memo_entry->empty[i]) {
+            commiter.cref(_memo_entry->values[i]);
+        }
+    }
+    return true;
+}
+
+void GraphVertex::memo_record() const noexcept {
+    if (!_memo_pending) {
+        return;
+    }
+    // 只记录已经全部发布且持有值的产出，引用外部对象的产出无法保证生命周期
+    ::std::shared_ptr<GraphVertexMemo::Entry> entry(new GraphVertexMemo::Entry);
+    entry->values.resize(_emits.size());
+    entry->empty.resize(_emits.size());
+    for (size_t i = 0; i < _emits.size(); ++i) {
+        auto data = _emits[i];
+        if (!data->ready() || data->_data.is_reference()) {
+            return;
+        }
+        entry->empty[i] = data->empty();
+        if (!data->empty()) {
+            entry->values[i] = data->_data;
+        }
+    }
+    // 保存依赖值的副本，命中时用于排除hash冲突，引用的值同样无法保证生命周期
+    if (_memo->verifiable()) {
+        entry->dependencies.resize(_dependencies.size());
+        entry->dependency_empty.resize(_dependencies.size());
+        for (size_t i = 0; i < _dependencies.size(); ++i) {
+            auto value = _dependencies[i].value<Any>();
+            entry->dependency_empty[i] = value == nullptr;
+            if (value != nullptr) {
+                if (value->is_reference()) {
+                    return;
+                }
+                entry->dependencies[i] = *value;
+            }
+        }
+    }
+    _memo->insert(_memo_key, ::std::move(entry));
+}
+
+GraphVertex*& GraphVertex::running_vertex() noexcept {
+    static thread_local GraphVertex* vertex = nullptr;
+    return vertex;
+}
+
+GraphVertex::CostTimer*& GraphVertex::cost_timer() noexcept {
+    static thread_local CostTimer* timer = nullptr;
+    return timer;
+}
+
 GraphProcessor GraphVertex::DEFAULT_EMPTY_PROCESSOR;
+constexpr size_t GraphVertex::CONTINUATION_STACK_SIZE;
 } // graph
 } // feed
 } // joewu
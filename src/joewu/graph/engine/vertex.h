@@ -5,6 +5,8 @@
 #include <joewu/feed/mlarch/babylon/application_context.h>
 #include <joewu/feed/mlarch/babylon/stack.h>
 #include <joewu/feed/mlarch/babylon/reusable/manager.h>
+#include <joewu/graph/engine/handle.h>
+#include <joewu/graph/engine/memo.h>
 
 #include <boost/preprocessor/cat.hpp>
 #include <boost/preprocessor/control/if.hpp>
@@ -17,6 +19,9 @@
 #include <boost/preprocessor/tuple/push_front.hpp>
 #include <boost/preprocessor/tuple/size.hpp>
 
+#include <atomic>
+#include <chrono>
+
 namespace joewu {
 namespace feed {
 namespace graph {
@@ -95,8 +100,51 @@ public:
     inline void done(int32_t error_code = 0) noexcept;
 
 private:
+    // 空闭包，供GraphVertex暂存调度中的闭包使用
+    inline GraphVertexClosure() noexcept = default;
+
     ClosureContext* _closure {nullptr};
     const GraphVertex* _vertex {nullptr};
+
+    friend class GraphVertex;
+};
+
+// 节点process耗时的滚动统计，由GraphVertexBuilder持有，跨多次图运行累计
+// 用于自动判定节点是否足够轻量，可以像平凡节点一样直接在当前线程运行
+class GraphVertexCost {
+public:
+    // 滚动窗口的样本数，积累满一个窗口后每次记录都按最近的窗口重新评估
+    static constexpr size_t WINDOW_SIZE = 64;
+    // p90耗时低于threshold_ns时提升为平凡节点
+    // 高于DEMOTE_RATIO倍threshold_ns时降级，中间区域保持不变，避免来回抖动
+    static constexpr uint64_t DEMOTE_RATIO = 2;
+
+    inline GraphVertexCost(uint64_t threshold_ns) noexcept;
+    // 当前是否按平凡节点运行
+    inline bool cheap() const noexcept;
+    // 当前窗口的p90耗时，现场排序计算，仅供观测使用
+    uint64_t p90() const noexcept;
+    // 记录一次从process开始到closure结束的耗时，不含期间嵌套运行的其他节点，可以并发调用
+    inline void record(uint64_t cost_ns) noexcept;
+    // 记录一次process返回时closure尚未结束，异步完成的算子不再按平凡节点运行
+    inline void record_asynchronous() noexcept;
+
+private:
+    // 窗口中p90所在的位置
+    // 不低于threshold_ns的样本少于WINDOW_SIZE - P90_INDEX个时，p90低于threshold_ns
+    static constexpr size_t P90_INDEX = WINDOW_SIZE * 9 / 10;
+
+    void evaluate() noexcept;
+
+    uint64_t _threshold_ns;
+    ::std::atomic<size_t> _sample_num {0};
+    ::std::atomic<uint64_t> _samples[WINDOW_SIZE];
+    // 窗口中不低于threshold_ns，以及高于DEMOTE_RATIO倍threshold_ns的样本数
+    // 替换样本时增量维护，并发记录时可能短暂为负
+    ::std::atomic<int64_t> _slow_num {0};
+    ::std::atomic<int64_t> _demote_num {0};
+    ::std::atomic<bool> _asynchronous {false};
+    ::std::atomic<bool> _cheap {false};
 };
 
 class Graph;
@@ -126,6 +174,22 @@ public:
     inline size_t anonymous_emit_size() const noexcept;
     inline __attribute__((deprecated)) GraphData* emit(size_t index) noexcept;
     inline __attribute__((deprecated)) size_t emit_size() const noexcept;
+    // 将名字或序号解析为句柄，最佳实践是在setup中使用
+    // 句柄只记录序号，可以保存在共享的processor或option中
+    // 不存在时返回无效句柄
+    template <typename T = Any>
+    inline DependencyHandle<T> named_dependency_handle(const ::std::string& name) const noexcept;
+    template <typename T = Any>
+    inline DependencyHandle<T> anonymous_dependency_handle(size_t index) const noexcept;
+    inline EmitHandle named_emit_handle(const ::std::string& name) const noexcept;
+    inline EmitHandle anonymous_emit_handle(size_t index) const noexcept;
+    // 通过句柄访问，只需要一次下标读取，句柄无效时返回nullptr
+    template <typename T>
+    inline GraphDependency* dependency(const DependencyHandle<T>& handle) noexcept;
+    // 等价于dependency(handle)->value<T>()
+    template <typename T>
+    inline const T* value(const DependencyHandle<T>& handle) const noexcept;
+    inline GraphData* emit(const EmitHandle& handle) noexcept;
     // 获取只读的选项配置，最佳实践是在setup中读取
     // 并将解析后的结果保存到context中
     template <typename T>
@@ -144,8 +208,12 @@ public:
     // 标记节点运行为平凡操作
     // 平凡操作在invoke时直接运行而非使用executor
     inline void trivial(bool trivial = true) noexcept;
+    // 是否直接在当前线程运行，手动标记为平凡或者自动统计耗时足够低
+    inline bool inplace() const noexcept;
 
     inline size_t index() const noexcept;
+    // 调度优先级，即到图末端的最长路径代价，越大越应该先运行
+    inline uint64_t priority() const noexcept;
 
     //补充算子运行期间日志信息，在processor阶段调用
     inline const ::std::string& clog() const noexcept;
@@ -183,6 +251,10 @@ private:
     // 供builder操作使用
     inline void builder(const GraphVertexBuilder& builder) noexcept;
     inline void executor(GraphExecutor& executor) noexcept;
+    inline void continuation(size_t max_depth) noexcept;
+    inline void cost(GraphVertexCost* cost) noexcept;
+    inline void memo(GraphVertexMemo* memo) noexcept;
+    inline void priority(uint64_t priority) noexcept;
     inline void index(size_t index) noexcept;
     inline void processor(ScopedComponent<GraphProcessor>&& processor) noexcept;
     inline ::std::vector<GraphDependency>& dependencies() noexcept;
@@ -197,11 +269,55 @@ private:
     inline ClosureContext* closure() noexcept;
     inline void invoke(Stack<GraphVertex*>& runnable_vertexes) noexcept;
     inline Stack<GraphVertex*>* runnable_vertexes() noexcept;
+    // 逐个invoke可运行节点直到清空
+    // 当前线程正在运行producer时，可以选出一个后继节点作为续体
+    // 续体暂存在producer上，等producer的process返回后再在当前线程运行
+    static void invoke_all(Stack<GraphVertex*>& runnable_vertexes,
+        GraphVertex* producer) noexcept;
+    // 存在未就绪或为空的必要依赖，此时节点不会运行，直接发布空的emits
+    inline bool essential_failed() const noexcept;
+    // 本次运行已经被取消，尚未开始的节点同样跳过
+    inline bool cancelled() const noexcept;
+    // 本次运行已经超过deadline，且产出只被非必要依赖消费，节点可以舍弃
+    inline bool shed() const noexcept;
+    // 以上任一情况成立时节点不运行算子
+    inline bool skippable() const noexcept;
+    // build完成后分析产出的消费方式，决定超时后是否可以舍弃
+    void analyze_sheddable() noexcept;
+    // build完成后分析产出的消费方式，被可变依赖消费时关闭缓存
+    void analyze_memo() noexcept;
+    // 根据依赖值查找缓存，命中时直接发布缓存的产出
+    // 未命中时记录key，在运行成功结束时由memo_record写入缓存
+    bool memo_hit() noexcept;
+    void memo_record() const noexcept;
+    // 不运行算子，直接发布空的emits，调用方需要设置running_vertex
+    inline void skip() noexcept;
+    // 将一批非平凡节点按各自的executor分组提交
+    static void run_batch(Stack<GraphVertex*>& vertexes) noexcept;
+    // 判断是否可以在当前线程以续体方式直接运行successor
+    inline bool can_continue_with(const GraphVertex& successor) const noexcept;
+    // 运行一个节点，返回运行期间选出的续体，没有则返回nullptr
+    // closure按值传入，返回后即析构，续体链中的节点逐个结束
+    inline GraphVertex* run_once(GraphVertexClosure closure) noexcept;
+    // 当前线程正在运行的节点
+    static GraphVertex*& running_vertex() noexcept;
+    // 当前线程上正在计时的一次节点运行
+    struct CostTimer {
+        const GraphVertex* vertex;
+        // closure在process返回前结束时记录结束时间
+        bool done;
+        ::std::chrono::steady_clock::time_point done_time;
+        // closure结束前嵌套运行的其他节点的耗时
+        uint64_t nested_ns;
+    };
+    static CostTimer*& cost_timer() noexcept;
     // 单测使用
     inline const GraphExecutor* executor() const noexcept;
     inline const GraphProcessor* processor() const noexcept;
 
     static GraphProcessor DEFAULT_EMPTY_PROCESSOR;
+    // 续体链累计占用栈空间的上限，超出后退回executor调度
+    static constexpr size_t CONTINUATION_STACK_SIZE = 128 * 1024;
 
     const GraphVertexBuilder* _builder {nullptr};
     size_t _index {0};
@@ -211,14 +327,43 @@ private:
     ::std::vector<GraphData*> _emits;
     Any _context;
     bool _trivial {false};
+    // 产出只被非必要依赖消费，超时后可以舍弃
+    bool _sheddable {false};
+    // 开启自动平凡判定时，记录耗时的统计
+    GraphVertexCost* _cost {nullptr};
+    // 开启结果缓存时，跨图实例共享的缓存
+    GraphVertexMemo* _memo {nullptr};
+    uint64_t _priority {0};
+    // 续体执行的最大深度，0表示关闭
+    size_t _continuation {0};
 
+    Graph* _graph {nullptr};
+
+    // 以下为运行状态，会被多个线程并发修改
+    // 从独立的缓存行开始，且整体按缓存行对齐
+    // 避免扇入节点的前驱并发完成时，和相邻vertex的运行状态伪共享
     // 激活标记
-    ::std::atomic<bool> _activated {false};
+    alignas(64) ::std::atomic<bool> _activated {false};
+    // Graph::reset和invalidate收集vertex时的去重标记
+    bool _touched {false};
     // 等待计数
     ::std::atomic<int64_t> _waiting_num {0};
     ClosureContext* _closure {nullptr};
     Stack<GraphVertex*>* _runnable_vertexes {nullptr};
-    Graph* _graph {nullptr};
+    // 作为续体运行时所处的深度，以及续体链起点的栈位置
+    size_t _continuation_depth {0};
+    const char* _stack_base {nullptr};
+    // 运行期间指向run_once栈上的续体槽位，选出的续体写入其中
+    // 不在run_once中运行时为nullptr或已失效，只在running_vertex为this时使用
+    GraphVertex** _continuation_slot {nullptr};
+    // executor调度期间暂存的闭包，调度时只需要传递vertex指针
+    // 每个vertex在一次运行中只会被调度一次，不会冲突
+    GraphVertexClosure _stashed_closure;
+    // 本次运行查找缓存的key，未命中时运行结束后写入
+    uint64_t _memo_key {0};
+    bool _memo_pending {false};
+    // 命中的缓存条目，产出引用其中的值，持有到reset
+    ::std::shared_ptr<const GraphVertexMemo::Entry> _memo_entry;
     //日志信息
     ::std::string _log;
     //算子级别内存复用manager
@@ -230,6 +375,8 @@ private:
     friend class GraphDependency;
     friend class GraphVertexBuilder;
     friend class GraphBuilder;
+    friend class GraphVertexClosure;
+    friend class BatchGraphProcessor;
     friend void* execute_invoke_vertex(void*);
 };
 
@@ -267,7 +414,7 @@ private:
         BOOST_PP_IF(is_mutable, \
             ::joewu::feed::graph::MutableInputChannel<__GRAPH_TYPE_FOR_NAME(name)> __hidden_channel_for_##name;, \
             ::joewu::feed::graph::InputChannel<__GRAPH_TYPE_FOR_NAME(name)> __hidden_channel_for_##name;), \
-        ::joewu::feed::graph::GraphDependency* __hidden_depend_for_##name;) \
+        ::joewu::feed::graph::DependencyHandle<__GRAPH_TYPE_FOR_NAME(name)> __hidden_depend_for_##name;) \
     BOOST_PP_IF(is_channel, \
         BOOST_PP_IF(is_mutable, \
             ::joewu::feed::graph::MutableChannelConsumer<__GRAPH_TYPE_FOR_NAME(name)> name;, \
@@ -300,7 +447,8 @@ private:
                 __hidden_channel_for_##name = depend->declare_mutable_channel<__GRAPH_TYPE_FOR_NAME(name)>(), \
                 __hidden_channel_for_##name = depend->declare_channel<__GRAPH_TYPE_FOR_NAME(name)>()), \
             depend->declare_type<__hidden_type_for_##name>(); \
-            __hidden_depend_for_##name = depend); \
+            __hidden_depend_for_##name = \
+                vertex.named_dependency_handle<__hidden_type_for_##name>(#name)); \
     }
 
 #define __GRAPH_DEFINE_EMIT(r, type, name, is_channel, ...) \
@@ -327,8 +475,9 @@ private:
     BOOST_PP_IF(is_channel, \
         name = __hidden_channel_for_##name.subscribe(), \
         BOOST_PP_IF(is_mutable, \
-            name = __hidden_depend_for_##name->mutable_value<__hidden_type_for_##name>(), \
-            name = __hidden_depend_for_##name->value<__hidden_type_for_##name>())); \
+            name = this->vertex().dependency(__hidden_depend_for_##name) \
+                ->mutable_value<__hidden_type_for_##name>(), \
+            name = this->vertex().value(__hidden_depend_for_##name))); \
     BOOST_PP_IF(BOOST_PP_GREATER(essential_level, 0), \
         if (!(bool)name) { \
             return -1; \
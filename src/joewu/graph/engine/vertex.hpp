@@ -8,6 +8,8 @@
 #include <joewu/graph/engine/graph.h>
 #include <joewu/graph/engine/data.h>
 
+#include <chrono>
+
 namespace joewu {
 namespace feed {
 namespace graph {
@@ -39,11 +41,19 @@ GraphVertexClosure& GraphVertexClosure::operator=(GraphVertexClosure&& other) no
 
 void GraphVertexClosure::done(int32_t error_code) noexcept {
     if (_closure != nullptr) {
+        // 在process返回前同步结束，记录结束时间供耗时统计使用
+        auto timer = GraphVertex::cost_timer();
+        if (timer != nullptr && timer->vertex == _vertex && !timer->done) {
+            timer->done = true;
+            timer->done_time = ::std::chrono::steady_clock::now();
+        }
         if (error_code != 0) {
             LOG(WARNING) << *_vertex << " done with " << error_code;
             _closure->finish(error_code);
         } else {
             LOG(DEBUG) << *_vertex << " done with " << error_code;
+            // 结束前graph仍然存活，可以读取产出写入缓存
+            _vertex->memo_record();
         }
         _closure->depend_vertex_sub();
         _closure = nullptr;
@@ -61,6 +71,35 @@ inline GraphVertex& GraphFunction::vertex() noexcept {
 // GraphFunction end
 ////////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////////////
+// GraphVertexCost begin
+GraphVertexCost::GraphVertexCost(uint64_t threshold_ns) noexcept :
+    _threshold_ns(threshold_ns), _samples() {}
+
+bool GraphVertexCost::cheap() const noexcept {
+    return _cheap.load(::std::memory_order_relaxed);
+}
+
+void GraphVertexCost::record(uint64_t cost_ns) noexcept {
+    auto index = _sample_num.fetch_add(1, ::std::memory_order_relaxed);
+    // 替换掉窗口中最旧的样本，初始的空样本为0，按不慢计
+    auto old_ns = _samples[index % WINDOW_SIZE].exchange(cost_ns, ::std::memory_order_relaxed);
+    _slow_num.fetch_add(static_cast<int64_t>(cost_ns >= _threshold_ns)
+        - static_cast<int64_t>(old_ns >= _threshold_ns), ::std::memory_order_relaxed);
+    _demote_num.fetch_add(static_cast<int64_t>(cost_ns > _threshold_ns * DEMOTE_RATIO)
+        - static_cast<int64_t>(old_ns > _threshold_ns * DEMOTE_RATIO), ::std::memory_order_relaxed);
+    if (index + 1 >= WINDOW_SIZE) {
+        evaluate();
+    }
+}
+
+void GraphVertexCost::record_asynchronous() noexcept {
+    _asynchronous.store(true, ::std::memory_order_relaxed);
+    _cheap.store(false, ::std::memory_order_relaxed);
+}
+// GraphVertexCost end
+////////////////////////////////////////////////////////////////////////////////
+
 ///////////////////////////////////////////////////////////////////////////////
 // GraphVertex begin
 void GraphVertex::builder(const GraphVertexBuilder& builder) noexcept {
@@ -71,6 +110,18 @@ void GraphVertex::executor(GraphExecutor& executor) noexcept {
     _executor = &executor;
 }
 
+void GraphVertex::continuation(size_t max_depth) noexcept {
+    _continuation = max_depth;
+}
+
+void GraphVertex::cost(GraphVertexCost* cost) noexcept {
+    _cost = cost;
+}
+
+void GraphVertex::memo(GraphVertexMemo* memo) noexcept {
+    _memo = memo;
+}
+
 void GraphVertex::index(size_t index) noexcept {
     _index = index;
 }
@@ -79,6 +130,14 @@ size_t GraphVertex::index() const noexcept {
     return _index;
 }
 
+void GraphVertex::priority(uint64_t priority) noexcept {
+    _priority = priority;
+}
+
+uint64_t GraphVertex::priority() const noexcept {
+    return _priority;
+}
+
 inline void GraphVertex::processor(ScopedComponent<GraphProcessor>&& processor) noexcept {
     _processor = ::std::move(processor);
 } 
@@ -103,9 +162,15 @@ void GraphVertex::reset() noexcept {
         denpendency.reset();
     }
     _runnable_vertexes = nullptr;
+    _continuation_depth = 0;
+    _stack_base = nullptr;
+    _continuation_slot = nullptr;
     _processor->reset(*this);
     _log.clear();
     _static_mem_manager.clear();
+    _touched = false;
+    _memo_pending = false;
+    _memo_entry.reset();
 }
 
 const ::std::string& GraphVertex::clog() const noexcept {
@@ -156,6 +221,63 @@ size_t GraphVertex::emit_size() const noexcept {
     return anonymous_emit_size();
 }
 
+template <typename T>
+DependencyHandle<T> GraphVertex::named_dependency_handle(const ::std::string& name) const noexcept {
+    size_t index = 0;
+    if (unlikely(!_builder->named_dependency_index(name, index))) {
+        return DependencyHandle<T>();
+    }
+    return DependencyHandle<T>(index);
+}
+
+template <typename T>
+DependencyHandle<T> GraphVertex::anonymous_dependency_handle(size_t index) const noexcept {
+    size_t real_index = 0;
+    if (unlikely(!_builder->anonymous_dependency_index(index, real_index))) {
+        return DependencyHandle<T>();
+    }
+    return DependencyHandle<T>(real_index);
+}
+
+EmitHandle GraphVertex::named_emit_handle(const ::std::string& name) const noexcept {
+    size_t index = 0;
+    if (unlikely(!_builder->named_emit_index(name, index))) {
+        return EmitHandle();
+    }
+    return EmitHandle(index);
+}
+
+EmitHandle GraphVertex::anonymous_emit_handle(size_t index) const noexcept {
+    size_t real_index = 0;
+    if (unlikely(!_builder->anonymous_emit_index(index, real_index))) {
+        return EmitHandle();
+    }
+    return EmitHandle(real_index);
+}
+
+template <typename T>
+GraphDependency* GraphVertex::dependency(const DependencyHandle<T>& handle) noexcept {
+    if (unlikely(handle.index() >= _dependencies.size())) {
+        return nullptr;
+    }
+    return &_dependencies[handle.index()];
+}
+
+template <typename T>
+const T* GraphVertex::value(const DependencyHandle<T>& handle) const noexcept {
+    if (unlikely(handle.index() >= _dependencies.size())) {
+        return nullptr;
+    }
+    return _dependencies[handle.index()].template value<T>();
+}
+
+GraphData* GraphVertex::emit(const EmitHandle& handle) noexcept {
+    if (unlikely(handle.index() >= _emits.size())) {
+        return nullptr;
+    }
+    return _emits[handle.index()];
+}
+
 template <typename T>
 const T* GraphVertex::option() const noexcept {
     return _builder->option<T>();
@@ -185,6 +307,10 @@ void GraphVertex::trivial(bool trivial) noexcept {
     _trivial = trivial;
 }
 
+bool GraphVertex::inplace() const noexcept {
+    return _trivial || (_cost != nullptr && _cost->cheap());
+}
+
 inline int32_t GraphVertex::setup() noexcept {
     return _processor->setup(*this);
 }
@@ -205,16 +331,45 @@ ClosureContext* GraphVertex::closure() noexcept {
     return _closure;
 }
 
-void GraphVertex::invoke(Stack<GraphVertex*>& runnable_vertexes) noexcept {
-    bool essential_failed = false;
+bool GraphVertex::essential_failed() const noexcept {
     for (auto& dependency : _dependencies) {
        if(dependency.is_essential() && (!dependency.ready() || dependency.empty())) {
-           essential_failed = true;
-           break;
+           return true;
        } 
     }
-    if(!essential_failed) {
-        if (_trivial) {
+    return false;
+}
+
+bool GraphVertex::cancelled() const noexcept {
+    return _closure->cancelled();
+}
+
+bool GraphVertex::shed() const noexcept {
+    if (!_sheddable || !_closure->expired()) {
+        return false;
+    }
+    // 产出被本次运行直接请求时，舍弃会让调用方拿到空值，不能舍弃
+    for (auto data : _emits) {
+        if (data->bound()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool GraphVertex::skippable() const noexcept {
+    return essential_failed() || cancelled() || shed();
+}
+
+void GraphVertex::skip() noexcept {
+    for (auto data : _emits) {
+        auto commiter = data->emit<Any>();
+    }
+}
+
+void GraphVertex::invoke(Stack<GraphVertex*>& runnable_vertexes) noexcept {
+    if (!skippable()) {
+        if (inplace()) {
             LOG(TRACE) << "inplace run " << *this;
             // todo: emit中可以记录一下是否来自trivial的vertex
             // 否则trivial的vertex不支持外部并发注入data
@@ -226,11 +381,16 @@ void GraphVertex::invoke(Stack<GraphVertex*>& runnable_vertexes) noexcept {
             _executor->run(this, GraphVertexClosure(*_closure, *this));
         }
     } else {
-        LOG(TRACE) << "essential_failed skip " << *this;
+        LOG(TRACE) << "essential_failed, cancelled or shed skip " << *this;
         _runnable_vertexes = &runnable_vertexes;
-        for(auto data : _emits) {  // 不运行算子，直接发布emits
-            auto commiter = data->emit<Any>();
-        }
+        // 和平凡节点运行一样标记当前节点，发布的后继节点进入传入的栈
+        // 不经过run_once，没有续体槽位，后继全部交给executor
+        _continuation_slot = nullptr;
+        auto& running = running_vertex();
+        auto previous = running;
+        running = this;
+        skip();
+        running = previous;
     }
 }
 
@@ -239,7 +399,86 @@ Stack<GraphVertex*>* GraphVertex::runnable_vertexes() noexcept {
 }
 
 void GraphVertex::run(GraphVertexClosure&& closure) noexcept {
+    // 续体在前一个节点的process返回后才运行，不嵌套在其发布数据的调用栈中
+    auto continuation = run_once(::std::move(closure));
+    while (continuation != nullptr) {
+        LOG(TRACE) << "continue run " << *continuation << " at depth "
+            << continuation->_continuation_depth;
+        continuation = continuation->run_once(::std::move(continuation->_stashed_closure));
+    }
+}
+
+GraphVertex* GraphVertex::run_once(GraphVertexClosure closure) noexcept {
+    GraphVertex* continuation = nullptr;
+    _continuation_slot = &continuation;
+    auto& running = running_vertex();
+    auto previous = running;
+    running = this;
+    if (_continuation_depth == 0) {
+        _stack_base = static_cast<const char*>(__builtin_frame_address(0));
+    }
+    // 在executor中排队期间被取消或超时舍弃，不再运行算子
+    // closure在返回后才析构，此前graph不会被销毁
+    if (unlikely(cancelled() || shed())) {
+        LOG(TRACE) << "cancelled or shed skip " << *this;
+        skip();
+        running = previous;
+        return continuation;
+    }
+    if (_memo != nullptr && memo_hit()) {
+        LOG(TRACE) << "memo hit skip " << *this;
+        closure.done(0);
+        running = previous;
+        return continuation;
+    }
+    // 运行结束后graph可能已经被销毁，不能再访问this
+    // 选出续体时其闭包已经创建，在续体运行结束前graph不会被销毁
+    auto cost = _cost;
+    auto& timer = cost_timer();
+    if (cost == nullptr && timer == nullptr) {
+        _processor->process(*this, ::std::move(closure));
+        running = previous;
+        return continuation;
+    }
+    // 外层节点正在计时时，没有开启统计的节点也需要计时，从外层的耗时中扣除
+    CostTimer current {this, false, {}, 0};
+    auto outer = timer;
+    timer = &current;
+    auto begin = ::std::chrono::steady_clock::now();
     _processor->process(*this, ::std::move(closure));
+    auto end = ::std::chrono::steady_clock::now();
+    timer = outer;
+    if (outer != nullptr && !outer->done) {
+        outer->nested_ns += ::std::chrono::duration_cast<::std::chrono::nanoseconds>(
+            end - begin).count();
+    }
+    if (cost != nullptr) {
+        if (current.done) {
+            // 只计process开始到closure结束，扣除期间同步运行的后继平凡节点
+            uint64_t elapsed_ns = ::std::chrono::duration_cast<::std::chrono::nanoseconds>(
+                current.done_time - begin).count();
+            cost->record(elapsed_ns > current.nested_ns ? elapsed_ns - current.nested_ns : 0);
+        } else {
+            cost->record_asynchronous();
+        }
+    }
+    running = previous;
+    return continuation;
+}
+
+bool GraphVertex::can_continue_with(const GraphVertex& successor) const noexcept {
+    // 只有在当前线程上运行producer时才能续体执行
+    // 避免异步算子在其回调线程中发布数据时，后继节点被拉到回调线程上运行
+    if (_continuation_depth >= _continuation || running_vertex() != this
+            || _continuation_slot == nullptr || *_continuation_slot != nullptr) {
+        return false;
+    }
+    // 使用其他executor的节点需要在其自身的线程池中运行，不能拉到当前线程
+    if (successor.inplace() || successor._executor != _executor) {
+        return false;
+    }
+    auto stack_top = static_cast<const char*>(__builtin_frame_address(0));
+    return static_cast<size_t>(_stack_base - stack_top) < CONTINUATION_STACK_SIZE;
 }
 
 bool GraphVertex::ready(GraphDependency*) noexcept {
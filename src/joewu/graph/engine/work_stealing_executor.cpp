@@ -0,0 +1,288 @@
+#include <joewu/graph/engine/work_stealing_executor.h>
+#include <joewu/graph/engine/closure.h>
+#include <joewu/graph/engine/vertex.h>
+
+#include <algorithm>
+#include <random>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+////////////////////////////////////////////////////////////////////////////////
+// WorkStealingGraphExecutor::Task begin
+// GraphVertex，ClosureContext和::std::function至少按指针对齐，最低两位可以用作标记
+static constexpr uintptr_t TASK_TAG_MASK = 3;
+static constexpr uintptr_t CALLBACK_TASK_TAG = 1;
+static constexpr uintptr_t FUNCTION_TASK_TAG = 2;
+
+WorkStealingGraphExecutor::Task WorkStealingGraphExecutor::vertex_task(
+    GraphVertex* vertex) noexcept {
+    return reinterpret_cast<Task>(vertex);
+}
+
+WorkStealingGraphExecutor::Task WorkStealingGraphExecutor::callback_task(
+    ClosureContext* closure) noexcept {
+    return reinterpret_cast<Task>(closure) | CALLBACK_TASK_TAG;
+}
+
+WorkStealingGraphExecutor::Task WorkStealingGraphExecutor::function_task(
+    ::std::function<void()>* function) noexcept {
+    return reinterpret_cast<Task>(function) | FUNCTION_TASK_TAG;
+}
+
+void WorkStealingGraphExecutor::run_task(Task task) noexcept {
+    auto tag = task & TASK_TAG_MASK;
+    if (tag == CALLBACK_TASK_TAG) {
+        reinterpret_cast<ClosureContext*>(task & ~TASK_TAG_MASK)->run_stashed();
+        return;
+    } else if (tag == FUNCTION_TASK_TAG) {
+        ::std::unique_ptr<::std::function<void()>> function(
+            reinterpret_cast<::std::function<void()>*>(task & ~TASK_TAG_MASK));
+        (*function)();
+        return;
+    }
+    auto vertex = reinterpret_cast<GraphVertex*>(task);
+    // 先移出到栈上，运行结束后graph可能已经被销毁
+    GraphVertexClosure closure(unstash(vertex));
+    run_vertex(vertex, ::std::move(closure));
+}
+// WorkStealingGraphExecutor::Task end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// WorkStealingGraphExecutor::Worker begin
+class WorkStealingGraphExecutor::Worker : public AlignedNew<Worker> {
+public:
+    inline Worker(WorkStealingGraphExecutor& executor, size_t index) noexcept :
+        _executor(&executor), _index(index), _random(index) {}
+
+private:
+    WorkStealingGraphExecutor* _executor;
+    size_t _index;
+    ::std::minstd_rand _random;
+    WorkStealingDeque<Task> _deque;
+    ::std::thread _thread;
+
+    friend class WorkStealingGraphExecutor;
+};
+
+WorkStealingGraphExecutor::Worker*& WorkStealingGraphExecutor::current_worker() noexcept {
+    static thread_local Worker* worker = nullptr;
+    return worker;
+}
+// WorkStealingGraphExecutor::Worker end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// WorkStealingGraphExecutor begin
+WorkStealingGraphExecutor::WorkStealingGraphExecutor(size_t concurrency) noexcept {
+    if (unlikely(concurrency == 0)) {
+        LOG(WARNING) << "concurrency of work stealing executor should be positive, use 1";
+        concurrency = 1;
+    }
+    _workers.reserve(concurrency);
+    for (size_t i = 0; i < concurrency; ++i) {
+        _workers.emplace_back(new Worker(*this, i));
+    }
+    // 所有Worker就绪后再启动线程，保证窃取时_workers不再变化
+    for (auto& worker : _workers) {
+        auto worker_ptr = worker.get();
+        worker->_thread = ::std::thread([this, worker_ptr] {
+            loop(*worker_ptr);
+        });
+    }
+}
+
+WorkStealingGraphExecutor::~WorkStealingGraphExecutor() noexcept {
+    {
+        ::std::lock_guard<::std::mutex> lock(_sleep_mutex);
+        _stopped.store(true, ::std::memory_order_seq_cst);
+    }
+    _sleep_cond.notify_all();
+    for (auto& worker : _workers) {
+        worker->_thread.join();
+    }
+}
+
+Closure WorkStealingGraphExecutor::create_closure() noexcept {
+    return Closure::create_atomic<FutexWaiter>(*this);
+}
+
+int32_t WorkStealingGraphExecutor::run(GraphVertex* vertex,
+    GraphVertexClosure&& closure) noexcept {
+    if (unlikely(_stopped.load(::std::memory_order_acquire))) {
+        LOG(WARNING) << "work stealing executor stopped, can not run vertex";
+        return -1;
+    }
+    stash(vertex, ::std::move(closure));
+    submit(vertex_task(vertex));
+    return 0;
+}
+
+int32_t WorkStealingGraphExecutor::run(GraphVertex* vertexes[], size_t size) noexcept {
+    if (unlikely(_stopped.load(::std::memory_order_acquire))) {
+        LOG(WARNING) << "work stealing executor stopped, can not run vertexes";
+        return -1;
+    }
+    if (size == 0) {
+        return 0;
+    }
+    BABYLON_STACK(Task, tasks, size);
+    for (size_t i = 0; i < size; ++i) {
+        stash(vertexes[i], create_vertex_closure(vertexes[i]));
+        tasks.emplace_back(vertex_task(vertexes[i]));
+    }
+    submit(&tasks[0], size);
+    return 0;
+}
+
+int32_t WorkStealingGraphExecutor::run(ClosureContext* closure,
+    ClosureCallback* callback) noexcept {
+    if (unlikely(_stopped.load(::std::memory_order_acquire))) {
+        LOG(WARNING) << "work stealing executor stopped, can not run closure";
+        return -1;
+    }
+    closure->stash(callback);
+    submit(callback_task(closure));
+    return 0;
+}
+
+int32_t WorkStealingGraphExecutor::run(::std::function<void()>&& function) noexcept {
+    if (unlikely(_stopped.load(::std::memory_order_acquire))) {
+        LOG(WARNING) << "work stealing executor stopped, can not run function";
+        return -1;
+    }
+    submit(function_task(new ::std::function<void()>(::std::move(function))));
+    return 0;
+}
+
+void WorkStealingGraphExecutor::submit(Task task) noexcept {
+    submit(&task, 1);
+}
+
+void WorkStealingGraphExecutor::submit(const Task* tasks, size_t size) noexcept {
+    auto worker = current_worker();
+    if (worker != nullptr && worker->_executor == this) {
+        // 本地队列后进先出，逆序压入使靠前（优先级最高）的任务最先弹出
+        // 窃取者从另一端取走的则是优先级最低的任务
+        for (size_t i = size; i > 0; --i) {
+            worker->_deque.push(tasks[i - 1]);
+        }
+    } else {
+        ::std::lock_guard<::std::mutex> lock(_inject_mutex);
+        size_t num = _inject_num.load(::std::memory_order_relaxed);
+        size_t capacity = _inject_tasks.size();
+        if (num + size > capacity) {
+            // 倍增并把已有任务按顺序搬到头部
+            ::std::vector<Task> tasks_grown(::std::max(num + size,
+                        ::std::max<size_t>(capacity << 1, 64)));
+            for (size_t i = 0; i < num; ++i) {
+                tasks_grown[i] = _inject_tasks[(_inject_begin + i) % capacity];
+            }
+            _inject_tasks.swap(tasks_grown);
+            _inject_begin = 0;
+            capacity = _inject_tasks.size();
+        }
+        for (size_t i = 0; i < size; ++i) {
+            _inject_tasks[(_inject_begin + num + i) % capacity] = tasks[i];
+        }
+        _inject_num.fetch_add(size, ::std::memory_order_release);
+    }
+    _pending.fetch_add(size, ::std::memory_order_seq_cst);
+    signal();
+}
+
+WorkStealingGraphExecutor::Task WorkStealingGraphExecutor::take(Worker& worker) noexcept {
+    Task task = 0;
+    // 本地队列后进先出，最近产生的后继节点优先，数据更热
+    if (worker._deque.pop(task)) {
+        return task;
+    }
+    if (_inject_num.load(::std::memory_order_acquire) > 0) {
+        ::std::lock_guard<::std::mutex> lock(_inject_mutex);
+        size_t num = _inject_num.load(::std::memory_order_relaxed);
+        if (num > 0) {
+            task = _inject_tasks[_inject_begin];
+            _inject_begin = (_inject_begin + 1) % _inject_tasks.size();
+            _inject_num.store(num - 1, ::std::memory_order_relaxed);
+            return task;
+        }
+    }
+    return steal(worker);
+}
+
+WorkStealingGraphExecutor::Task WorkStealingGraphExecutor::steal(Worker& worker) noexcept {
+    Task task = 0;
+    size_t size = _workers.size();
+    // 随机起点，避免所有窃取者集中在同一个队列上
+    size_t start = worker._random() % size;
+    for (size_t i = 0; i < size; ++i) {
+        auto& victim = *_workers[(start + i) % size];
+        if (&victim == &worker) {
+            continue;
+        }
+        if (victim._deque.steal(task)) {
+            return task;
+        }
+    }
+    return 0;
+}
+
+void WorkStealingGraphExecutor::signal() noexcept {
+    if (_sleeping.load(::std::memory_order_seq_cst) > 0) {
+        // 持锁通知，避免等待方检查完_pending到进入wait之间的唤醒丢失
+        ::std::lock_guard<::std::mutex> lock(_sleep_mutex);
+        _sleep_cond.notify_one();
+    }
+}
+
+void WorkStealingGraphExecutor::wait(Worker&) noexcept {
+    ::std::unique_lock<::std::mutex> lock(_sleep_mutex);
+    _sleeping.fetch_add(1, ::std::memory_order_seq_cst);
+    while (_pending.load(::std::memory_order_seq_cst) == 0
+            && !_stopped.load(::std::memory_order_relaxed)) {
+        _sleep_cond.wait(lock);
+    }
+    _sleeping.fetch_sub(1, ::std::memory_order_relaxed);
+}
+
+void WorkStealingGraphExecutor::loop(Worker& worker) noexcept {
+    // 空闲后进入休眠前的自旋轮数
+    static constexpr size_t SPIN_ROUND = 64;
+    current_worker() = &worker;
+    size_t idle_round = 0;
+    while (true) {
+        auto task = take(worker);
+        if (task != 0) {
+            // 还有剩余任务时接力唤醒下一个空闲线程，批量提交只需要唤醒一次
+            if (_pending.fetch_sub(1, ::std::memory_order_seq_cst) > 1) {
+                signal();
+            }
+            run_task(task);
+            idle_round = 0;
+            continue;
+        }
+        if (_pending.load(::std::memory_order_acquire) > 0) {
+            // 有任务正在被其他线程取走或者窃取竞争失败，重试
+            ::std::this_thread::yield();
+            continue;
+        }
+        if (_stopped.load(::std::memory_order_acquire)) {
+            break;
+        }
+        if (idle_round++ < SPIN_ROUND) {
+            ::std::this_thread::yield();
+            continue;
+        }
+        wait(worker);
+        idle_round = 0;
+    }
+    current_worker() = nullptr;
+}
+// WorkStealingGraphExecutor end
+////////////////////////////////////////////////////////////////////////////////
+
+} // graph
+} // feed
+} // joewu
@@ -0,0 +1,122 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_WORK_STEALING_EXECUTOR_H
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_WORK_STEALING_EXECUTOR_H
+
+#include <joewu/graph/engine/aligned.h>
+#include <joewu/graph/engine/expect.h>
+#include <joewu/graph/engine/executor.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+// Chase-Lev无锁双端队列，内存序参考
+// Correct and Efficient Work-Stealing for Weak Memory Models (PPoPP'13)
+// 只有所有者线程可以push和pop，从底部操作，后进先出
+// 其他线程可以并发steal，从顶部操作，先进先出
+// 容量不足时自动倍增，旧的缓冲区延迟到析构时释放，避免和steal竞争
+template <typename T>
+class WorkStealingDeque {
+public:
+    inline WorkStealingDeque(size_t capacity = 1024) noexcept;
+    inline WorkStealingDeque(const WorkStealingDeque&) = delete;
+    inline ~WorkStealingDeque() noexcept;
+
+    // 【所有者】从底部压入
+    inline void push(T item) noexcept;
+    // 【所有者】从底部弹出，空时返回false
+    inline bool pop(T& item) noexcept;
+    // 【任意线程】从顶部窃取，空或者竞争失败时返回false
+    inline bool steal(T& item) noexcept;
+
+    // 近似值，仅用于判断是否有待窃取的任务
+    inline bool empty() const noexcept;
+    inline size_t size() const noexcept;
+
+private:
+    class Buffer;
+
+    inline Buffer* grow(Buffer* buffer, int64_t bottom, int64_t top) noexcept;
+
+    alignas(64) ::std::atomic<int64_t> _top {0};
+    alignas(64) ::std::atomic<int64_t> _bottom {0};
+    alignas(64) ::std::atomic<Buffer*> _buffer {nullptr};
+    ::std::vector<Buffer*> _retired_buffers;
+};
+
+// 使用工作窃取线程池进行调度的图执行器，不依赖bthread
+// 每个工作线程持有一个WorkStealingDeque
+// 工作线程中发起的调度（典型如GraphData::release触发的后继节点）
+// 压入本线程队列，后进先出，使数据在同一个核上保持热度
+// 空闲的工作线程从其他线程的队列顶部窃取，外部线程发起的调度经由共享队列注入
+// 调度参数暂存在vertex和closure中，任务只是一个带标记的指针，调度时不分配内存
+class WorkStealingGraphExecutor : public GraphExecutor,
+    public AlignedNew<WorkStealingGraphExecutor> {
+public:
+    // 启动concurrency个工作线程
+    WorkStealingGraphExecutor(size_t concurrency) noexcept;
+    // 等待已经提交的任务执行完，并停止所有工作线程
+    virtual ~WorkStealingGraphExecutor() noexcept;
+
+    virtual Closure create_closure() noexcept override;
+    virtual int32_t run(GraphVertex* vertex,
+        GraphVertexClosure&& closure) noexcept override;
+    virtual int32_t run(ClosureContext* closure, ::std::function<void(Closure&&)>* callback) noexcept override;
+    // 整批任务一次性压入队列，只唤醒一次，后续由被唤醒的工作线程逐级唤醒其他线程
+    virtual int32_t run(GraphVertex* vertexes[], size_t size) noexcept override;
+    // 普通函数需要分配一个任务对象，只用于算子攒批超时等低频场景
+    virtual int32_t run(::std::function<void()>&& function) noexcept override;
+
+    inline size_t concurrency() const noexcept;
+
+private:
+    // 低位标记区分GraphVertex，ClosureContext和普通函数，0表示没有任务
+    typedef uintptr_t Task;
+    class Worker;
+
+    static Task vertex_task(GraphVertex* vertex) noexcept;
+    static Task callback_task(ClosureContext* closure) noexcept;
+    static Task function_task(::std::function<void()>* function) noexcept;
+    static void run_task(Task task) noexcept;
+
+    // 当前线程所属的工作线程，非工作线程为nullptr
+    static Worker*& current_worker() noexcept;
+    // 提交一个任务，工作线程中提交到本地队列，否则注入共享队列
+    void submit(Task task) noexcept;
+    // 提交一组任务，靠前的优先运行
+    void submit(const Task* tasks, size_t size) noexcept;
+    // 依次从本地队列，共享队列，其他线程队列获取任务
+    Task take(Worker& worker) noexcept;
+    Task steal(Worker& worker) noexcept;
+    void signal() noexcept;
+    void wait(Worker& worker) noexcept;
+    void loop(Worker& worker) noexcept;
+
+    ::std::vector<::std::unique_ptr<Worker>> _workers;
+
+    // 外部线程提交的任务，环形缓冲区，容量不足时倍增，稳态下不再分配
+    ::std::mutex _inject_mutex;
+    ::std::vector<Task> _inject_tasks;
+    size_t _inject_begin {0};
+    ::std::atomic<size_t> _inject_num {0};
+
+    // 空闲工作线程休眠和唤醒
+    ::std::mutex _sleep_mutex;
+    ::std::condition_variable _sleep_cond;
+    alignas(64) ::std::atomic<int64_t> _pending {0};
+    alignas(64) ::std::atomic<size_t> _sleeping {0};
+    ::std::atomic<bool> _stopped {false};
+};
+
+} // graph
+} // feed
+} // joewu
+#endif //joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_WORK_STEALING_EXECUTOR_H
+
+#include <joewu/graph/engine/work_stealing_executor.hpp>
@@ -0,0 +1,143 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_WORK_STEALING_EXECUTOR_HPP
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_WORK_STEALING_EXECUTOR_HPP
+
+#include <joewu/graph/engine/work_stealing_executor.h>
+
+namespace joewu {
+namespace feed {
+namespace graph {
+
+////////////////////////////////////////////////////////////////////////////////
+// WorkStealingDeque begin
+template <typename T>
+class WorkStealingDeque<T>::Buffer {
+public:
+    inline Buffer(size_t capacity) noexcept :
+        _mask(capacity - 1), _items(new ::std::atomic<T>[capacity]) {}
+
+    inline size_t capacity() const noexcept {
+        return _mask + 1;
+    }
+
+    inline void store(int64_t index, T item) noexcept {
+        _items[index & _mask].store(item, ::std::memory_order_relaxed);
+    }
+
+    inline T load(int64_t index) const noexcept {
+        return _items[index & _mask].load(::std::memory_order_relaxed);
+    }
+
+private:
+    size_t _mask;
+    ::std::unique_ptr<::std::atomic<T>[]> _items;
+};
+
+template <typename T>
+inline WorkStealingDeque<T>::WorkStealingDeque(size_t capacity) noexcept {
+    // 向上取整到2的幂，方便取模
+    size_t real_capacity = 1;
+    while (real_capacity < capacity) {
+        real_capacity <<= 1;
+    }
+    _buffer.store(new Buffer(real_capacity), ::std::memory_order_relaxed);
+}
+
+template <typename T>
+inline WorkStealingDeque<T>::~WorkStealingDeque() noexcept {
+    delete _buffer.load(::std::memory_order_relaxed);
+    for (auto buffer : _retired_buffers) {
+        delete buffer;
+    }
+}
+
+template <typename T>
+inline void WorkStealingDeque<T>::push(T item) noexcept {
+    auto bottom = _bottom.load(::std::memory_order_relaxed);
+    auto top = _top.load(::std::memory_order_acquire);
+    auto buffer = _buffer.load(::std::memory_order_relaxed);
+    if (unlikely(bottom - top > static_cast<int64_t>(buffer->capacity()) - 1)) {
+        buffer = grow(buffer, bottom, top);
+    }
+    buffer->store(bottom, item);
+    ::std::atomic_thread_fence(::std::memory_order_release);
+    _bottom.store(bottom + 1, ::std::memory_order_relaxed);
+}
+
+template <typename T>
+inline bool WorkStealingDeque<T>::pop(T& item) noexcept {
+    auto bottom = _bottom.load(::std::memory_order_relaxed) - 1;
+    auto buffer = _buffer.load(::std::memory_order_relaxed);
+    _bottom.store(bottom, ::std::memory_order_relaxed);
+    ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+    auto top = _top.load(::std::memory_order_relaxed);
+    if (unlikely(top > bottom)) {
+        // 队列为空，恢复
+        _bottom.store(bottom + 1, ::std::memory_order_relaxed);
+        return false;
+    }
+    item = buffer->load(bottom);
+    if (top == bottom) {
+        // 最后一个元素，和steal竞争
+        bool success = _top.compare_exchange_strong(top, top + 1,
+            ::std::memory_order_seq_cst, ::std::memory_order_relaxed);
+        _bottom.store(bottom + 1, ::std::memory_order_relaxed);
+        return success;
+    }
+    return true;
+}
+
+template <typename T>
+inline bool WorkStealingDeque<T>::steal(T& item) noexcept {
+    auto top = _top.load(::std::memory_order_acquire);
+    ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+    auto bottom = _bottom.load(::std::memory_order_acquire);
+    if (top >= bottom) {
+        return false;
+    }
+    // 这里读到的buffer可能已经被grow替换，但旧buffer在析构前不会释放
+    // 且[top, bottom)范围内的元素在新旧buffer中一致
+    auto buffer = _buffer.load(::std::memory_order_consume);
+    item = buffer->load(top);
+    return _top.compare_exchange_strong(top, top + 1,
+        ::std::memory_order_seq_cst, ::std::memory_order_relaxed);
+}
+
+template <typename T>
+inline bool WorkStealingDeque<T>::empty() const noexcept {
+    return size() == 0;
+}
+
+template <typename T>
+inline size_t WorkStealingDeque<T>::size() const noexcept {
+    auto bottom = _bottom.load(::std::memory_order_relaxed);
+    auto top = _top.load(::std::memory_order_relaxed);
+    return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+}
+
+template <typename T>
+inline typename WorkStealingDeque<T>::Buffer* WorkStealingDeque<T>::grow(
+    Buffer* buffer, int64_t bottom, int64_t top) noexcept {
+    auto new_buffer = new Buffer(buffer->capacity() << 1);
+    for (auto i = top; i < bottom; ++i) {
+        new_buffer->store(i, buffer->load(i));
+    }
+    _retired_buffers.emplace_back(buffer);
+    _buffer.store(new_buffer, ::std::memory_order_release);
+    return new_buffer;
+}
+// WorkStealingDeque end
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// WorkStealingGraphExecutor begin
+inline size_t WorkStealingGraphExecutor::concurrency() const noexcept {
+    return _workers.size();
+}
+// WorkStealingGraphExecutor end
+////////////////////////////////////////////////////////////////////////////////
+
+} // graph
+} // feed
+} // joewu
+
+#endif //joewu_HAOKAN_REC_GRAPH_ENGINE_GRAPH_WORK_STEALING_EXECUTOR_HPP
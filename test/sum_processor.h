@@ -0,0 +1,107 @@
+#ifndef joewu_HAOKAN_REC_GRAPH_ENGINE_TEST_SUM_PROCESSOR_H
+#define joewu_HAOKAN_REC_GRAPH_ENGINE_TEST_SUM_PROCESSOR_H
+
+#include <joewu/graph/engine/vertex.h>
+#include <joewu/graph/engine/builder.h>
+
+#include <string>
+
+// 单测和benchmark共用的算子和图结构
+// 结果都输出到A，每个节点的产出为所有依赖求和加一
+
+// 所有依赖求和加一后输出，依赖缺失时失败
+class SumProcessor : public ::joewu::feed::graph::GraphProcessor {
+public:
+    virtual int32_t process(::joewu::feed::graph::GraphVertex& vertex) noexcept override {
+        int32_t sum = 1;
+        for (size_t i = 0; i < vertex.anonymous_dependency_size(); ++i) {
+            auto value = vertex.anonymous_dependency(i)->value<int32_t>();
+            if (value == nullptr) {
+                return -1;
+            }
+            sum += *value;
+        }
+        *vertex.anonymous_emit(0)->emit<int32_t>() = sum;
+        return 0;
+    }
+};
+
+// A <- B
+inline void build_pair(::joewu::feed::graph::GraphBuilder& builder,
+    ::joewu::feed::graph::GraphProcessor& processor) {
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("A");
+        v.anonymous_depend().to("B");
+    }
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("B");
+    }
+}
+
+// A <- {B, C} <- D
+inline void build_diamond(::joewu::feed::graph::GraphBuilder& builder,
+    ::joewu::feed::graph::GraphProcessor& processor) {
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("A");
+        v.anonymous_depend().to("B");
+        v.anonymous_depend().to("C");
+    }
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("B");
+        v.anonymous_depend().to("D");
+    }
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("C");
+        v.anonymous_depend().to("D");
+    }
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("D");
+    }
+}
+
+// A <- {B0, B1, ..., Bn-1}
+inline void build_fan_out(::joewu::feed::graph::GraphBuilder& builder,
+    ::joewu::feed::graph::GraphProcessor& processor, size_t width) {
+    auto& root = builder.add_vertex(processor);
+    root.anonymous_emit().to("A");
+    for (size_t i = 0; i < width; ++i) {
+        root.anonymous_depend().to("B" + ::std::to_string(i));
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("B" + ::std::to_string(i));
+    }
+}
+
+// A <- {B0, B1, ..., Bn-1} <- S
+inline void build_wide_diamond(::joewu::feed::graph::GraphBuilder& builder,
+    ::joewu::feed::graph::GraphProcessor& processor, size_t width) {
+    auto& root = builder.add_vertex(processor);
+    root.anonymous_emit().to("A");
+    for (size_t i = 0; i < width; ++i) {
+        root.anonymous_depend().to("B" + ::std::to_string(i));
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("B" + ::std::to_string(i));
+        v.anonymous_depend().to("S");
+    }
+    auto& source = builder.add_vertex(processor);
+    source.anonymous_emit().to("S");
+}
+
+// A <- C1 <- C2 <- ... <- Cn-1
+inline void build_chain(::joewu::feed::graph::GraphBuilder& builder,
+    ::joewu::feed::graph::GraphProcessor& processor, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to(i == 0 ? "A" : "C" + ::std::to_string(i));
+        if (i + 1 < width) {
+            v.anonymous_depend().to("C" + ::std::to_string(i + 1));
+        }
+    }
+}
+
+#endif //joewu_HAOKAN_REC_GRAPH_ENGINE_TEST_SUM_PROCESSOR_H
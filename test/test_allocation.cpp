@@ -0,0 +1,189 @@
+#include <atomic>
+#include <thread>
+#include <new>
+#include <string>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <gtest/gtest.h>
+#include <base/logging.h>
+#include <joewu/graph/engine/graph.h>
+#include <joewu/graph/engine/data.h>
+#include <joewu/graph/engine/vertex.h>
+#include <joewu/graph/engine/builder.h>
+#include <joewu/graph/engine/closure.h>
+#include <joewu/graph/engine/work_stealing_executor.h>
+#include "sum_processor.h"
+
+using ::joewu::feed::graph::GraphBuilder;
+using ::joewu::feed::graph::GraphProcessor;
+using ::joewu::feed::graph::GraphVertex;
+using ::joewu::feed::graph::Graph;
+using ::joewu::feed::graph::Closure;
+using ::joewu::feed::graph::WorkStealingGraphExecutor;
+
+// 统计全局内存分配次数
+static ::std::atomic<size_t> allocation_num {0};
+
+void* operator new(size_t size) {
+    allocation_num.fetch_add(1, ::std::memory_order_relaxed);
+    void* ptr = ::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw ::std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    ::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    ::free(ptr);
+}
+
+// 按依赖数输出一个bool
+class BoolProcessor : public GraphProcessor {
+    virtual int32_t process(GraphVertex& vertex) noexcept override {
+        *vertex.anonymous_emit(0)->emit<bool>() = vertex.anonymous_dependency_size() == 0;
+        return 0;
+    }
+};
+
+// 复用graph运行一次，返回期间的内存分配次数
+static size_t count_run_allocation(Graph& graph, bool use_on_finish) {
+    graph.reset();
+    auto a = graph.find_data("A");
+    auto begin = allocation_num.load();
+    {
+        auto closure = graph.run(a);
+        if (use_on_finish) {
+            ::std::atomic<bool> called {false};
+            auto* called_ptr = &called;
+            closure.on_finish([called_ptr] (Closure&& closure) {
+                closure.wait();
+                called_ptr->store(true, ::std::memory_order_release);
+            });
+            while (!called.load(::std::memory_order_acquire)) {
+                ::std::this_thread::yield();
+            }
+        } else {
+            closure.get();
+            closure.wait();
+        }
+    }
+    return allocation_num.load() - begin;
+}
+
+TEST(allocation, dispatch_vertex_without_allocation) {
+    SumProcessor processor;
+    GraphBuilder narrow_builder;
+    build_wide_diamond(narrow_builder, processor, 1);
+    ASSERT_EQ(0, narrow_builder.finish());
+    GraphBuilder wide_builder;
+    build_wide_diamond(wide_builder, processor, 64);
+    ASSERT_EQ(0, wide_builder.finish());
+    auto narrow_graph = narrow_builder.build();
+    auto wide_graph = wide_builder.build();
+    // 预热，完成各种惰性初始化
+    for (size_t i = 0; i < 10; ++i) {
+        count_run_allocation(*narrow_graph, false);
+        count_run_allocation(*wide_graph, false);
+    }
+    // 调度节点不再分配内存，分配次数和节点数无关
+    ASSERT_EQ(count_run_allocation(*narrow_graph, false),
+        count_run_allocation(*wide_graph, false));
+    ASSERT_EQ(129, *wide_graph->find_data("A")->cvalue<int32_t>());
+}
+
+TEST(allocation, on_finish_without_allocation) {
+    SumProcessor processor;
+    GraphBuilder builder;
+    build_wide_diamond(builder, processor, 4);
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    for (size_t i = 0; i < 10; ++i) {
+        count_run_allocation(*graph, false);
+        count_run_allocation(*graph, true);
+    }
+    // 回调存放在closure中，通过executor调度回调也不分配内存
+    ASSERT_EQ(count_run_allocation(*graph, false), count_run_allocation(*graph, true));
+    ASSERT_EQ(0, count_run_allocation(*graph, true));
+}
+
+TEST(allocation, work_stealing_executor_dispatch_without_allocation) {
+    WorkStealingGraphExecutor executor(4);
+    SumProcessor processor;
+    GraphBuilder builder;
+    builder.executor(executor);
+    build_wide_diamond(builder, processor, 64);
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    // 预热，本地队列和共享队列的容量增长到位
+    for (size_t i = 0; i < 10; ++i) {
+        count_run_allocation(*graph, false);
+        count_run_allocation(*graph, true);
+    }
+    // 调度参数暂存在vertex和closure中，不再为每次调度分配任务对象
+    ASSERT_EQ(0, count_run_allocation(*graph, false));
+    ASSERT_EQ(0, count_run_allocation(*graph, true));
+    ASSERT_EQ(129, *graph->find_data("A")->cvalue<int32_t>());
+}
+
+TEST(allocation, steady_state_run_allocation_independent_of_graph_shape) {
+    SumProcessor processor;
+    BoolProcessor bool_processor;
+    // 单节点图，作为基准只包含每次运行固定的分配
+    GraphBuilder single_builder;
+    {
+        auto& v = single_builder.add_vertex(processor);
+        v.anonymous_emit().to("A");
+    }
+    ASSERT_EQ(0, single_builder.finish());
+    // 带条件依赖的图，A <- B <- C on D <- E
+    GraphBuilder condition_builder;
+    {
+        auto& v = condition_builder.add_vertex(processor);
+        v.anonymous_emit().to("A");
+        v.anonymous_depend().to("B");
+    }
+    {
+        auto& v = condition_builder.add_vertex(processor);
+        v.anonymous_emit().to("B");
+        v.anonymous_depend().to("C").on("D");
+    }
+    {
+        auto& v = condition_builder.add_vertex(processor);
+        v.anonymous_emit().to("C");
+        v.anonymous_depend().to("E");
+    }
+    {
+        auto& v = condition_builder.add_vertex(bool_processor);
+        v.anonymous_emit().to("D");
+    }
+    {
+        auto& v = condition_builder.add_vertex(processor);
+        v.anonymous_emit().to("E");
+    }
+    ASSERT_EQ(0, condition_builder.finish());
+    // 开启续体执行的长链
+    GraphBuilder chain_builder;
+    chain_builder.continuation();
+    build_chain(chain_builder, processor, 32);
+    ASSERT_EQ(0, chain_builder.finish());
+
+    auto single_graph = single_builder.build();
+    auto condition_graph = condition_builder.build();
+    auto chain_graph = chain_builder.build();
+    for (size_t i = 0; i < 10; ++i) {
+        count_run_allocation(*single_graph, false);
+        count_run_allocation(*condition_graph, false);
+        count_run_allocation(*chain_graph, false);
+    }
+    auto baseline = count_run_allocation(*single_graph, false);
+    ASSERT_EQ(baseline, count_run_allocation(*condition_graph, false));
+    ASSERT_EQ(4, *condition_graph->find_data("A")->cvalue<int32_t>());
+    ASSERT_EQ(baseline, count_run_allocation(*chain_graph, false));
+    ASSERT_EQ(32, *chain_graph->find_data("A")->cvalue<int32_t>());
+    // closure由graph复用，稳态运行不再有任何分配
+    ASSERT_EQ(0, baseline);
+}
@@ -0,0 +1,170 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <base/logging.h>
+#include <joewu/graph/engine/graph.h>
+#include <joewu/graph/engine/data.h>
+#include <joewu/graph/engine/vertex.h>
+#include <joewu/graph/engine/builder.h>
+#include <joewu/graph/engine/closure.h>
+#include <joewu/graph/engine/batch_processor.h>
+#include <joewu/graph/engine/work_stealing_executor.h>
+
+using ::joewu::feed::graph::BatchGraphProcessor;
+using ::joewu::feed::graph::Graph;
+using ::joewu::feed::graph::GraphBuilder;
+using ::joewu::feed::graph::GraphVertex;
+using ::joewu::feed::graph::WorkStealingGraphExecutor;
+
+// 每个vertex输出依赖值加上所在批次的大小
+class AddBatchSizeProcessor : public BatchGraphProcessor {
+public:
+    AddBatchSizeProcessor(size_t max_batch_size, ::std::chrono::microseconds max_delay,
+        int32_t ret = 0) noexcept :
+        BatchGraphProcessor(max_batch_size, max_delay), _ret(ret) {}
+
+protected:
+    virtual int32_t process_batch(GraphVertex* vertexes[], size_t size) noexcept override {
+        if (_ret != 0) {
+            return _ret;
+        }
+        for (size_t i = 0; i < size; ++i) {
+            auto value = vertexes[i]->anonymous_dependency(0)->value<int32_t>();
+            *vertexes[i]->anonymous_emit(0)->emit<int32_t>() = *value + size;
+        }
+        return 0;
+    }
+
+private:
+    int32_t _ret;
+};
+
+static void build(GraphBuilder& builder, BatchGraphProcessor& processor) {
+    auto& v = builder.add_vertex(processor);
+    v.anonymous_emit().to("B");
+    v.anonymous_depend().to("A");
+    ASSERT_EQ(0, builder.finish());
+}
+
+TEST(batch_processor, coalesce_concurrent_graphs_when_batch_full) {
+    static constexpr size_t CONCURRENCY = 8;
+    // 超时足够长，只能由攒满触发
+    AddBatchSizeProcessor processor(CONCURRENCY, ::std::chrono::seconds(60));
+    GraphBuilder builder;
+    build(builder, processor);
+    ::std::vector<::std::unique_ptr<Graph>> graphs;
+    for (size_t i = 0; i < CONCURRENCY; ++i) {
+        graphs.emplace_back(builder.build());
+        *graphs.back()->find_data("A")->emit<int32_t>() = i;
+    }
+    ::std::vector<::std::thread> threads;
+    ::std::atomic<size_t> failed {0};
+    for (size_t i = 0; i < CONCURRENCY; ++i) {
+        threads.emplace_back([&, i] {
+            auto& graph = graphs[i];
+            if (0 != graph->run(graph->find_data("B")).get()) {
+                failed++;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(0, failed.load());
+    ASSERT_EQ(1, processor.batch_num());
+    ASSERT_EQ(CONCURRENCY, processor.batched_vertex_num());
+    for (size_t i = 0; i < CONCURRENCY; ++i) {
+        ASSERT_EQ(static_cast<int32_t>(i + CONCURRENCY),
+            *graphs[i]->find_data("B")->cvalue<int32_t>());
+    }
+}
+
+TEST(batch_processor, flush_partial_batch_after_delay) {
+    AddBatchSizeProcessor processor(64, ::std::chrono::milliseconds(10));
+    GraphBuilder builder;
+    build(builder, processor);
+    auto graph = builder.build();
+    *graph->find_data("A")->emit<int32_t>() = 1;
+    auto begin = ::std::chrono::steady_clock::now();
+    ASSERT_EQ(0, graph->run(graph->find_data("B")).get());
+    ASSERT_LE(::std::chrono::milliseconds(10), ::std::chrono::steady_clock::now() - begin);
+    ASSERT_EQ(2, *graph->find_data("B")->cvalue<int32_t>());
+    ASSERT_EQ(1, processor.batch_num());
+    // reset后可以继续攒批运行
+    graph->reset();
+    *graph->find_data("A")->emit<int32_t>() = 2;
+    ASSERT_EQ(0, graph->run(graph->find_data("B")).get());
+    ASSERT_EQ(3, *graph->find_data("B")->cvalue<int32_t>());
+    ASSERT_EQ(2, processor.batch_num());
+}
+
+// 记录通过run提交的普通函数个数
+class CountingFunctionExecutor : public WorkStealingGraphExecutor {
+public:
+    CountingFunctionExecutor(size_t concurrency) noexcept :
+        WorkStealingGraphExecutor(concurrency) {}
+
+    virtual int32_t run(::std::function<void()>&& function) noexcept override {
+        function_num++;
+        return WorkStealingGraphExecutor::run(::std::move(function));
+    }
+    using WorkStealingGraphExecutor::run;
+
+    ::std::atomic<size_t> function_num {0};
+};
+
+// 记录process_batch所在的线程
+class RecordThreadProcessor : public AddBatchSizeProcessor {
+public:
+    RecordThreadProcessor() noexcept :
+        AddBatchSizeProcessor(64, ::std::chrono::milliseconds(10)) {}
+
+    ::std::thread::id thread_id;
+
+protected:
+    virtual int32_t process_batch(GraphVertex* vertexes[], size_t size) noexcept override {
+        thread_id = ::std::this_thread::get_id();
+        return AddBatchSizeProcessor::process_batch(vertexes, size);
+    }
+};
+
+TEST(batch_processor, flush_partial_batch_on_vertex_executor) {
+    CountingFunctionExecutor executor(2);
+    RecordThreadProcessor processor;
+    GraphBuilder builder;
+    builder.executor(executor);
+    build(builder, processor);
+    auto graph = builder.build();
+    *graph->find_data("A")->emit<int32_t>() = 1;
+    ASSERT_EQ(0, graph->run(graph->find_data("B")).get());
+    ASSERT_EQ(2, *graph->find_data("B")->cvalue<int32_t>());
+    // 超时的批次交给executor运行，而不是在后台计时线程上运行
+    ASSERT_EQ(1, executor.function_num.load());
+    ASSERT_NE(::std::this_thread::get_id(), processor.thread_id);
+}
+
+TEST(batch_processor, batch_size_one_run_directly) {
+    AddBatchSizeProcessor processor(1, ::std::chrono::seconds(60));
+    GraphBuilder builder;
+    build(builder, processor);
+    auto graph = builder.build();
+    *graph->find_data("A")->emit<int32_t>() = 1;
+    ASSERT_EQ(0, graph->run(graph->find_data("B")).get());
+    ASSERT_EQ(2, *graph->find_data("B")->cvalue<int32_t>());
+}
+
+TEST(batch_processor, fail_every_vertex_in_batch) {
+    AddBatchSizeProcessor processor(2, ::std::chrono::milliseconds(10), -1);
+    GraphBuilder builder;
+    build(builder, processor);
+    auto first = builder.build();
+    auto second = builder.build();
+    *first->find_data("A")->emit<int32_t>() = 1;
+    *second->find_data("A")->emit<int32_t>() = 1;
+    auto first_future = first->run(first->find_data("B"));
+    auto second_future = second->run(second->find_data("B"));
+    ASSERT_NE(0, first_future.get());
+    ASSERT_NE(0, second_future.get());
+}
@@ -111,3 +111,67 @@ TEST(builder, non_exist_graph_processor_component_report_fail_when_build) {
     auto graph = builder.build();
     ASSERT_FALSE((bool)graph);
 }
+
+TEST(builder, priority_is_longest_remaining_path) {
+    OneProcessor processor;
+    GraphBuilder builder;
+    builder.executor(executor);
+    // A <- B <- C <- D
+    //   <- E
+    auto& a = builder.add_vertex(processor);
+    a.anonymous_emit().to("A");
+    a.anonymous_depend().to("B");
+    a.anonymous_depend().to("E");
+    auto& b = builder.add_vertex(processor);
+    b.anonymous_emit().to("B");
+    b.anonymous_depend().to("C");
+    auto& c = builder.add_vertex(processor);
+    c.anonymous_emit().to("C");
+    c.anonymous_depend().to("X").on("D");
+    auto& d = builder.add_vertex(processor);
+    d.anonymous_emit().to("D");
+    auto& e = builder.add_vertex(processor);
+    e.anonymous_emit().to("E");
+    ASSERT_EQ(0, builder.finish());
+    ASSERT_EQ(1, a.priority());
+    ASSERT_EQ(2, b.priority());
+    ASSERT_EQ(3, c.priority());
+    ASSERT_EQ(4, d.priority());
+    ASSERT_EQ(2, e.priority());
+    auto graph = builder.build();
+    ASSERT_EQ(4, graph->vertexes()[3].priority());
+}
+
+TEST(builder, priority_weighted_by_estimated_cost) {
+    OneProcessor processor;
+    GraphBuilder builder;
+    builder.executor(executor);
+    auto& a = builder.add_vertex(processor);
+    a.anonymous_emit().to("A");
+    a.anonymous_depend().to("B");
+    a.anonymous_depend().to("C");
+    auto& b = builder.add_vertex(processor);
+    b.anonymous_emit().to("B");
+    b.anonymous_depend().to("D");
+    auto& c = builder.add_vertex(processor).estimated_cost(100);
+    c.anonymous_emit().to("C");
+    auto& d = builder.add_vertex(processor).estimated_cost(10);
+    d.anonymous_emit().to("D");
+    ASSERT_EQ(0, builder.finish());
+    ASSERT_EQ(1, a.priority());
+    ASSERT_EQ(101, c.priority());
+    ASSERT_EQ(12, d.priority());
+}
+
+TEST(builder, executor_override_by_vertex) {
+    OneProcessor processor;
+    BthreadGraphExecutor other_executor;
+    GraphBuilder builder;
+    builder.executor(executor);
+    builder.add_vertex(processor);
+    builder.add_vertex(processor).executor(other_executor);
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    ASSERT_EQ(&executor, graph->vertexes()[0].executor());
+    ASSERT_EQ(&other_executor, graph->vertexes()[1].executor());
+}
@@ -1,5 +1,6 @@
 #include <thread>
 #include <future>
+#include <vector>
 #include <inttypes.h>
 #include <gtest/gtest.h>
 #include <base/logging.h>
@@ -9,6 +10,8 @@
 
 using ::joewu::feed::graph::Closure;
 using ::joewu::feed::graph::BthreadGraphExecutor;
+using ::joewu::feed::graph::FutexWaiter;
+using ::joewu::feed::graph::ButexWaiter;
 
 BthreadGraphExecutor executor;
 
@@ -185,3 +188,133 @@ TEST(closure, default_constructor_and_move_assignment) {
     // on_finish返回时，callback已经执行
     ASSERT_TRUE(done.load());
 }
+
+template <typename W>
+static void finish_and_flush_wake_all_waiters() {
+    auto closure = Closure::create_atomic<W>(executor);
+    auto context = closure.context();
+    context->depend_data_add();
+    context->depend_vertex_add();
+    context->fire();
+    ::std::atomic<size_t> finished(0);
+    ::std::atomic<size_t> flushed(0);
+    ::std::vector<::std::thread> threads;
+    for (size_t i = 0; i < 4; ++i) {
+        threads.emplace_back([&] {
+            if (0 == context->get()) {
+                finished++;
+            }
+            context->wait();
+            flushed++;
+        });
+    }
+    usleep(100000);
+    ASSERT_EQ(0, finished.load());
+    context->depend_data_sub();
+    usleep(100000);
+    ASSERT_EQ(4, finished.load());
+    ASSERT_EQ(0, flushed.load());
+    context->depend_vertex_sub();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(4, flushed.load());
+    // 已经进入稳态时直接返回
+    ASSERT_EQ(0, closure.get());
+    closure.wait();
+}
+
+TEST(closure, atomic_closure_wake_all_waiters) {
+    finish_and_flush_wake_all_waiters<FutexWaiter>();
+    finish_and_flush_wake_all_waiters<ButexWaiter>();
+}
+
+TEST(closure, atomic_closure_rearm_when_reuse) {
+    auto closure = Closure::create_atomic<FutexWaiter>(executor);
+    auto context = closure.context();
+    context->pooled();
+    context->fire();
+    ASSERT_EQ(0, closure.get());
+    context->release();
+    ASSERT_TRUE(context->reuse());
+    ASSERT_FALSE(closure.finished());
+    context->depend_data_add();
+    context->depend_vertex_add();
+    context->fire();
+    ::std::thread([context] {
+        usleep(100000);
+        context->finish(-10086);
+        context->depend_vertex_sub();
+    }).detach();
+    ASSERT_EQ(-10086, closure.get());
+    closure.wait();
+    context->abandon();
+}
+
+TEST(closure, wait_with_timeout) {
+    auto closure = Closure::create_atomic<FutexWaiter>(executor);
+    auto compatible_closure = Closure::create<::bthread::Mutex>(executor);
+    for (auto one : {&closure, &compatible_closure}) {
+        auto context = one->context();
+        context->depend_data_add();
+        context->depend_vertex_add();
+        context->fire();
+        int32_t error_code = 0;
+        ASSERT_FALSE(one->get_for(::std::chrono::milliseconds(10), error_code));
+        ASSERT_FALSE(one->wait_for(::std::chrono::milliseconds(10)));
+        ::std::thread([context] {
+            usleep(100000);
+            context->depend_data_sub();
+            usleep(100000);
+            context->depend_vertex_sub();
+        }).detach();
+        ASSERT_TRUE(one->get_for(::std::chrono::seconds(10), error_code));
+        ASSERT_EQ(0, error_code);
+        ASSERT_TRUE(one->wait_for(::std::chrono::seconds(10)));
+    }
+}
+
+TEST(closure, callback_invoke_inplace_on_finishing_thread) {
+    auto closure = Closure::create_atomic<FutexWaiter>(executor);
+    auto context = closure.context();
+    context->depend_data_add();
+    context->depend_vertex_add();
+    context->fire();
+    ::std::thread::id callback_thread_id;
+    closure.on_finish([&] (Closure&& closure) {
+        callback_thread_id = ::std::this_thread::get_id();
+        ASSERT_TRUE(closure.finished());
+        // 丢弃closure不等待稳态，此时还有运行中的节点
+    }, true);
+    ::std::thread::id finish_thread_id;
+    ::std::thread([&] {
+        finish_thread_id = ::std::this_thread::get_id();
+        context->depend_data_sub();
+        // 回调已经同步执行完毕
+        ASSERT_EQ(finish_thread_id, callback_thread_id);
+        context->depend_vertex_sub();
+    }).join();
+    ASSERT_EQ(finish_thread_id, callback_thread_id);
+}
+
+TEST(closure, drop_moved_closure_in_inplace_callback_not_block) {
+    auto closure = Closure::create_atomic<FutexWaiter>(executor);
+    auto context = closure.context();
+    context->depend_data_add();
+    context->depend_vertex_add();
+    context->fire();
+    bool called = false;
+    closure.on_finish([&] (Closure&& closure) {
+        // 转移到局部变量后在回调中析构，此时还有运行中的节点
+        // 析构不能等待稳态，否则会阻塞住需要由本线程完成的节点
+        Closure local(::std::move(closure));
+        ASSERT_TRUE(local.finished());
+        called = true;
+    }, true);
+    ::std::thread([&] {
+        context->depend_data_sub();
+        ASSERT_TRUE(called);
+        context->depend_vertex_sub();
+    }).join();
+    ASSERT_TRUE(called);
+}
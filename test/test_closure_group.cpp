@@ -0,0 +1,170 @@
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <gtest/gtest.h>
+#include <base/logging.h>
+#include <joewu/graph/engine/graph.h>
+#include <joewu/graph/engine/data.h>
+#include <joewu/graph/engine/vertex.h>
+#include <joewu/graph/engine/builder.h>
+#include <joewu/graph/engine/closure.h>
+#include <joewu/graph/engine/closure_group.h>
+#include <joewu/graph/engine/executor.h>
+#include "sum_processor.h"
+
+using ::joewu::feed::graph::Closure;
+using ::joewu::feed::graph::ClosureGroup;
+using ::joewu::feed::graph::FutexWaiter;
+using ::joewu::feed::graph::BthreadGraphExecutor;
+using ::joewu::feed::graph::GraphBuilder;
+using ::joewu::feed::graph::GraphProcessor;
+using ::joewu::feed::graph::GraphVertex;
+
+static BthreadGraphExecutor executor;
+
+// 创建一个等待一个data的closure，delay_us后以error_code结束
+static Closure finish_later(int64_t delay_us, int32_t error_code) {
+    auto closure = Closure::create_atomic<FutexWaiter>(executor);
+    auto context = closure.context();
+    context->depend_data_add();
+    context->depend_vertex_add();
+    context->fire();
+    ::std::thread([context, delay_us, error_code] {
+        usleep(delay_us);
+        context->finish(error_code);
+        context->depend_data_sub();
+        context->depend_vertex_sub();
+    }).detach();
+    return closure;
+}
+
+template <typename C>
+static bool wait_until(C condition) {
+    for (size_t i = 0; i < 5000 && !condition(); ++i) {
+        usleep(1000);
+    }
+    return condition();
+}
+
+TEST(closure_group, when_all_fire_once_after_all_finished) {
+    ::std::vector<Closure> closures;
+    closures.emplace_back(finish_later(10000, 0));
+    closures.emplace_back(finish_later(100000, -1));
+    closures.emplace_back(finish_later(50000, 0));
+    ::std::atomic<size_t> called {0};
+    ::std::atomic<bool> all_finished {false};
+    ::std::atomic<int32_t> second_error_code {0};
+    ClosureGroup::when_all(::std::move(closures)).then([&] (ClosureGroup&& group) {
+        bool finished = group.size() == 3;
+        for (size_t i = 0; i < group.size(); ++i) {
+            finished = finished && group.finished(i);
+        }
+        all_finished = finished;
+        second_error_code = group.error_code(1);
+        // 最后进入终止态的是第二个
+        ASSERT_EQ(1, group.index());
+        called++;
+    });
+    ASSERT_TRUE(wait_until([&] { return called.load() > 0; }));
+    usleep(10000);
+    ASSERT_EQ(1, called.load());
+    ASSERT_TRUE(all_finished.load());
+    ASSERT_EQ(-1, second_error_code.load());
+}
+
+TEST(closure_group, when_any_fire_on_first_finished) {
+    ::std::vector<Closure> closures;
+    closures.emplace_back(finish_later(200000, 0));
+    closures.emplace_back(finish_later(10000, -10086));
+    ::std::atomic<size_t> called {0};
+    ::std::atomic<size_t> index {0};
+    ::std::atomic<bool> other_finished {true};
+    ClosureGroup::when_any(::std::move(closures)).then([&] (ClosureGroup&& group) {
+        index = group.index();
+        ASSERT_EQ(-10086, group.error_code(group.index()));
+        other_finished = group.finished(0);
+        called++;
+    });
+    ASSERT_TRUE(wait_until([&] { return called.load() > 0; }));
+    ASSERT_EQ(1, index.load());
+    ASSERT_FALSE(other_finished.load());
+    // 较慢的closure结束后不再触发回调
+    usleep(300000);
+    ASSERT_EQ(1, called.load());
+}
+
+TEST(closure_group, fire_in_place_when_already_finished) {
+    ::std::vector<Closure> closures;
+    for (size_t i = 0; i < 3; ++i) {
+        closures.emplace_back(finish_later(0, 0));
+        closures.back().wait();
+    }
+    bool called = false;
+    ClosureGroup::when_all(::std::move(closures)).then([&] (ClosureGroup&& group) {
+        ASSERT_EQ(3, group.size());
+        called = true;
+    });
+    // 全部已经结束，then返回时回调已经执行
+    ASSERT_TRUE(called);
+
+    called = false;
+    ClosureGroup::when_all(::std::vector<Closure>()).then([&] (ClosureGroup&& group) {
+        ASSERT_EQ(0, group.size());
+        called = true;
+    });
+    ASSERT_TRUE(called);
+}
+
+TEST(closure_group, fan_out_to_multiple_graphs) {
+    SumProcessor processor;
+    GraphBuilder builder;
+    build_pair(builder, processor);
+    ASSERT_EQ(0, builder.finish());
+    ::std::vector<::std::unique_ptr<::joewu::feed::graph::Graph>> graphs;
+    ::std::vector<Closure> closures;
+    for (size_t i = 0; i < 8; ++i) {
+        graphs.emplace_back(builder.build());
+        closures.emplace_back(graphs.back()->run(graphs.back()->find_data("A")));
+    }
+    ::std::atomic<int32_t> sum {0};
+    ::std::atomic<int32_t> value_sum {0};
+    ::std::atomic<bool> done {false};
+    // 全部进入稳态后才回调，可以直接在回调中销毁图
+    ClosureGroup::when_all_flushed(::std::move(closures)).then([&] (ClosureGroup&& group) {
+        for (size_t i = 0; i < group.size(); ++i) {
+            sum += group.error_code(i);
+            value_sum += *graphs[i]->find_data("A")->cvalue<int32_t>();
+        }
+        graphs.clear();
+        done = true;
+    });
+    ASSERT_TRUE(wait_until([&] { return done.load(); }));
+    ASSERT_EQ(0, sum.load());
+    ASSERT_EQ(16, value_sum.load());
+    ASSERT_TRUE(graphs.empty());
+}
+
+TEST(closure_group, when_all_flushed_wait_running_vertex) {
+    ::std::vector<Closure> closures;
+    ::std::vector<::joewu::feed::graph::ClosureContext*> contexts;
+    for (size_t i = 0; i < 2; ++i) {
+        closures.emplace_back(finish_later(10000, 0));
+        contexts.push_back(closures.back().context());
+    }
+    // 模拟结束后仍在运行的节点
+    contexts[1]->depend_vertex_add();
+    ::std::atomic<size_t> called {0};
+    ::std::atomic<bool> all_finished {false};
+    ClosureGroup::when_all_flushed(::std::move(closures)).then([&] (ClosureGroup&& group) {
+        all_finished = group.finished(0) && group.finished(1);
+        called++;
+    });
+    ASSERT_TRUE(wait_until([&] { return contexts[1]->finished(); }));
+    usleep(10000);
+    // 已经进入终止态，但还有节点运行中，不会回调
+    ASSERT_EQ(0, called.load());
+    contexts[1]->depend_vertex_sub();
+    ASSERT_TRUE(wait_until([&] { return called.load() > 0; }));
+    ASSERT_EQ(1, called.load());
+    ASSERT_TRUE(all_finished.load());
+}
@@ -11,6 +11,7 @@
 
 using joewu::feed::graph::Graph;
 using joewu::feed::graph::GraphData;
+using joewu::feed::graph::AlignedVector;
 using joewu::feed::graph::GraphVertex;
 using joewu::feed::graph::GraphBuilder;
 using joewu::feed::graph::GraphProcessor;
@@ -60,7 +61,30 @@ struct DataTest : public ::testing::Test {
 };
 
 TEST(data, default_constructable) {
-    ::std::vector<GraphData> data(10);
+    AlignedVector<GraphData> data(10);
+}
+
+TEST(data, running_state_not_share_cache_line_with_neighbour) {
+    AlignedVector<GraphData> data(2);
+    auto line = [] (const void* address) {
+        return reinterpret_cast<uintptr_t>(address) / 64;
+    };
+    ASSERT_EQ(0, sizeof(GraphData) % 64);
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(&data[0]._acquired) % 64);
+    // 运行状态不和静态信息以及相邻data共用缓存行
+    ASSERT_LT(line(&data[0]._on_emit), line(&data[0]._acquired));
+    ASSERT_LT(line(&data[0]._data), line(&data[1]));
+    ASSERT_LT(line(&data[0]._closure), line(&data[1]._closure));
+}
+
+TEST(data, static_info_fit_in_one_cache_line) {
+    AlignedVector<GraphData> data(1);
+    // 图规模和executor由Graph和GraphPlan提供，data只保留自身的静态信息
+    auto offset = reinterpret_cast<uintptr_t>(&data[0]._acquired)
+        - reinterpret_cast<uintptr_t>(&data[0]);
+    ASSERT_EQ(64, offset);
+    ASSERT_EQ(0, data[0].data_num());
+    ASSERT_EQ(0, data[0].vertex_num());
 }
 
 TEST(data, acquire_success_only_once) {
@@ -10,12 +10,14 @@
 using ::joewu::feed::mlarch::babylon::Stack;
 using ::joewu::feed::graph::Closure;
 using ::joewu::feed::graph::BthreadGraphExecutor;
+using ::joewu::feed::graph::Graph;
 using ::joewu::feed::graph::GraphBuilder;
 using ::joewu::feed::graph::GraphDependency;
 using ::joewu::feed::graph::GraphDependencyBuilder;
 using ::joewu::feed::graph::GraphVertex;
 using ::joewu::feed::graph::GraphVertexBuilder;
 using ::joewu::feed::graph::GraphData;
+using ::joewu::feed::graph::AlignedVector;
 using ::joewu::feed::graph::GraphProcessor;
 using ::joewu::feed::graph::ClosureContext;
 using ::joewu::feed::graph::ClosureContextImplement;
@@ -55,9 +57,13 @@ public:
     GraphVertexBuilder& vertex_builder = graph_builder.add_vertex(processor);
     GraphDependencyBuilder builder {vertex_builder.named_depend("x")};
     GraphVertex vertex;
+    // 作为data的producer，需要存活到TearDown中closure结束
+    GraphVertex target_vertex;
     GraphDependency dependency;
+    // data通过所属的graph获取图规模
+    Graph graph;
     ClosureContext* closure {new ClosureContextImplement<::bthread::Mutex>(executor)};
-    ::std::vector<GraphData> data {1024};
+    AlignedVector<GraphData> data {1024};
     ::std::unordered_map<::std::string, size_t> data_index_by_name;
     GraphVertex* _runnable_vertexes[1024];
     Stack<GraphVertex*> runnable_vertexes {_runnable_vertexes, 1024};
@@ -148,9 +154,9 @@ TEST_F(DependencyTest, activate_condition_if_not_ready_yet) {
 TEST_F(DependencyTest, activate_target_when_condition_establish) {
     builder.to("target").on("condition");
     ASSERT_EQ(0, builder.finish(data_index_by_name));
-    GraphVertex target_vertex;
     data[0].producer(target_vertex);
-    data[0].data_num(2);
+    AlignedVector<GraphData>(2).swap(graph._data);
+    data[0].graph(graph);
     builder.build(dependency, vertex, data);
     ASSERT_EQ(0, dependency.activate(activating_data));
     ASSERT_EQ(1, activating_data.size());
@@ -167,7 +173,6 @@ TEST_F(DependencyTest, activate_target_when_condition_establish) {
 TEST_F(DependencyTest, empty_when_target_empty) {
     builder.to("target");
     ASSERT_EQ(0, builder.finish(data_index_by_name));
-    GraphVertex target_vertex;
     builder.build(dependency, vertex, data);
     ASSERT_EQ(0, dependency.activate(activating_data));
     ASSERT_EQ(1, activating_data.size());
@@ -183,9 +188,9 @@ TEST_F(DependencyTest, empty_when_target_empty) {
 TEST_F(DependencyTest, dependency_reuseable_after_reset) {
     builder.to("target").on("condition");
     ASSERT_EQ(0, builder.finish(data_index_by_name));
-    GraphVertex target_vertex;
     data[0].producer(target_vertex);
-    data[0].data_num(2);
+    AlignedVector<GraphData>(2).swap(graph._data);
+    data[0].graph(graph);
     builder.build(dependency, vertex, data);
 
     {
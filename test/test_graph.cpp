@@ -1,6 +1,11 @@
+#include <atomic>
+#include <chrono>
 #include <future>
+#include <mutex>
 #include <inttypes.h>
 #include <sstream>
+#include <thread>
+#include <vector>
 #include <gflags/gflags.h>
 #include <gtest/gtest.h>
 #include <base/logging.h>
@@ -17,6 +22,7 @@ using joewu::feed::mlarch::babylon::Any;
 using joewu::feed::graph::GraphBuilder;
 using joewu::feed::graph::GraphProcessor;
 using joewu::feed::graph::GraphVertex;
+using joewu::feed::graph::GraphVertexClosure;
 using joewu::feed::graph::Commiter;
 using joewu::feed::graph::GraphData;
 using joewu::feed::graph::GraphLog;
@@ -310,3 +316,826 @@ TEST(graph, support_reuse_obj_function) {
     ASSERT_EQ(10, message->size());
 }
 #endif
+
+class RecordContinuationProcessor : public GraphProcessor {
+public:
+    RecordContinuationProcessor(size_t size) : depths(size), threads(size) {}
+
+    virtual int32_t process(GraphVertex& vertex) noexcept override {
+        depths[vertex.index()] = vertex._continuation_depth;
+        threads[vertex.index()] = ::std::this_thread::get_id();
+        *vertex.anonymous_emit(0)->emit<int32_t>() = 1;
+        return 0;
+    }
+
+    ::std::vector<size_t> depths;
+    ::std::vector<::std::thread::id> threads;
+};
+
+// V0 <- V1 <- ... <- V(size-1)，并开启续体执行
+static void build_continuation_chain(GraphBuilder& builder,
+    GraphProcessor& processor, size_t size, size_t max_depth) {
+    builder.continuation(max_depth);
+    for (size_t i = 0; i < size; ++i) {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("C" + ::std::to_string(i));
+        if (i + 1 < size) {
+            v.anonymous_depend().to("C" + ::std::to_string(i + 1));
+        }
+    }
+    builder.finish();
+}
+
+TEST(graph, continuation_run_chain_on_same_thread) {
+    RecordContinuationProcessor processor(4);
+    GraphBuilder builder;
+    BthreadGraphExecutor executor;
+    builder.executor(executor);
+    build_continuation_chain(builder, processor, 4, 32);
+    auto graph = builder.build();
+    ASSERT_EQ(0, graph->run(graph->find_data("C0")).get());
+    ASSERT_EQ(3, processor.depths[0]);
+    ASSERT_EQ(2, processor.depths[1]);
+    ASSERT_EQ(1, processor.depths[2]);
+    ASSERT_EQ(0, processor.depths[3]);
+    for (size_t i = 0; i < 3; ++i) {
+        ASSERT_EQ(processor.threads[3], processor.threads[i]);
+    }
+}
+
+TEST(graph, continuation_limited_by_max_depth) {
+    RecordContinuationProcessor processor(4);
+    GraphBuilder builder;
+    BthreadGraphExecutor executor;
+    builder.executor(executor);
+    build_continuation_chain(builder, processor, 4, 2);
+    auto graph = builder.build();
+    ASSERT_EQ(0, graph->run(graph->find_data("C0")).get());
+    ASSERT_EQ(0, processor.depths[0]);
+    ASSERT_EQ(2, processor.depths[1]);
+    ASSERT_EQ(1, processor.depths[2]);
+    ASSERT_EQ(0, processor.depths[3]);
+}
+
+TEST(graph, continuation_disabled_when_max_depth_is_zero) {
+    RecordContinuationProcessor processor(4);
+    GraphBuilder builder;
+    BthreadGraphExecutor executor;
+    builder.executor(executor);
+    build_continuation_chain(builder, processor, 4, 0);
+    auto graph = builder.build();
+    ASSERT_EQ(0, graph->run(graph->find_data("C0")).get());
+    for (auto depth : processor.depths) {
+        ASSERT_EQ(0, depth);
+    }
+}
+
+// 发布后才标记process返回，记录运行时前驱的process是否已经返回
+class RecordReturnedProcessor : public GraphProcessor {
+public:
+    RecordReturnedProcessor(size_t size) : returned(size), predecessor_returned(size) {}
+
+    virtual int32_t process(GraphVertex& vertex) noexcept override {
+        auto index = vertex.index();
+        if (index + 1 < returned.size()) {
+            predecessor_returned[index] = returned[index + 1].load();
+        }
+        {
+            auto commiter = vertex.anonymous_emit(0)->emit<int32_t>();
+            *commiter = 1;
+            commiter.release();
+        }
+        returned[index] = true;
+        return 0;
+    }
+
+    ::std::vector<::std::atomic<bool>> returned;
+    ::std::vector<bool> predecessor_returned;
+};
+
+TEST(graph, continuation_run_after_producer_returned) {
+    RecordReturnedProcessor processor(4);
+    GraphBuilder builder;
+    BthreadGraphExecutor executor;
+    builder.executor(executor);
+    build_continuation_chain(builder, processor, 4, 32);
+    auto graph = builder.build();
+    ASSERT_EQ(0, graph->run(graph->find_data("C0")).get());
+    // 续体不嵌套在前驱发布数据的调用栈中运行
+    for (size_t i = 0; i < 3; ++i) {
+        ASSERT_TRUE(processor.predecessor_returned[i]);
+    }
+}
+
+// 记录节点调度和平凡节点运行的先后顺序
+static ::std::mutex order_mutex;
+static ::std::vector<::std::string> order;
+
+class RecordOrderExecutor : public BthreadGraphExecutor {
+public:
+    using BthreadGraphExecutor::run;
+    virtual int32_t run(GraphVertex* vertexes[], size_t size) noexcept override {
+        {
+            ::std::lock_guard<::std::mutex> lock(order_mutex);
+            for (size_t i = 0; i < size; ++i) {
+                order.emplace_back("dispatch " + vertexes[i]->name());
+            }
+        }
+        return BthreadGraphExecutor::run(vertexes, size);
+    }
+};
+
+class TrivialRecordProcessor : public GraphProcessor {
+    virtual int32_t setup(GraphVertex& vertex) const noexcept override {
+        vertex.trivial();
+        return 0;
+    }
+    virtual int32_t process(GraphVertex& vertex) noexcept override {
+        {
+            ::std::lock_guard<::std::mutex> lock(order_mutex);
+            order.emplace_back("run " + vertex.name());
+        }
+        *vertex.anonymous_emit(0)->emit<int32_t>() = 1;
+        return 0;
+    }
+};
+
+TEST(graph, dispatch_async_vertex_before_run_trivial_vertex) {
+    ConstProcessor heavy_processor;
+    TrivialRecordProcessor trivial_processor;
+    GraphBuilder builder;
+    RecordOrderExecutor executor;
+    builder.executor(executor);
+    {
+        auto& v = builder.add_vertex(trivial_processor);
+        v.name("T1");
+        v.anonymous_emit().to("A");
+        // 平凡节点T2后激活，位于可运行栈顶
+        v.anonymous_depend().to("B");
+        v.anonymous_depend().to("C");
+    }
+    {
+        auto& v = builder.add_vertex(trivial_processor);
+        v.name("T2");
+        v.anonymous_emit().to("B");
+    }
+    {
+        auto& v = builder.add_vertex(heavy_processor);
+        v.name("H");
+        v.anonymous_emit().to("C");
+    }
+    builder.finish();
+    order.clear();
+    auto graph = builder.build();
+    ASSERT_EQ(0, graph->run(graph->find_data("A")).get());
+    ASSERT_LE(2, order.size());
+    ASSERT_EQ("dispatch H", order[0]);
+    ASSERT_EQ("run T2", order[1]);
+}
+
+TEST(graph, dispatch_critical_path_first) {
+    ConstProcessor processor;
+    GraphBuilder builder;
+    RecordOrderExecutor executor;
+    builder.executor(executor);
+    {
+        auto& v = builder.add_vertex(processor);
+        v.name("A");
+        v.anonymous_emit().to("A");
+        // S后激活，位于可运行栈顶，但L2所在的链更长
+        v.anonymous_depend().to("S");
+        v.anonymous_depend().to("L");
+    }
+    {
+        auto& v = builder.add_vertex(processor);
+        v.name("L");
+        v.anonymous_emit().to("L");
+        v.anonymous_depend().to("L2");
+    }
+    {
+        auto& v = builder.add_vertex(processor);
+        v.name("L2");
+        v.anonymous_emit().to("L2");
+    }
+    {
+        auto& v = builder.add_vertex(processor);
+        v.name("S");
+        v.anonymous_emit().to("S");
+    }
+    builder.finish();
+    order.clear();
+    auto graph = builder.build();
+    ASSERT_EQ(0, graph->run(graph->find_data("A")).get());
+    ASSERT_LE(2, order.size());
+    ASSERT_EQ("dispatch L2", order[0]);
+    ASSERT_EQ("dispatch S", order[1]);
+}
+
+// 模拟耗时可变的算子
+class DelayProcessor : public GraphProcessor {
+public:
+    virtual int32_t process(GraphVertex& vertex) noexcept override {
+        auto delay = delay_us.load();
+        if (delay > 0) {
+            ::std::this_thread::sleep_for(::std::chrono::microseconds(delay));
+        }
+        *vertex.anonymous_emit(0)->emit<int32_t>() = 1;
+        run_times++;
+        return 0;
+    }
+
+    ::std::atomic<int64_t> delay_us {0};
+    ::std::atomic<size_t> run_times {0};
+};
+
+static void run_delay_graph(GraphBuilder& builder, size_t times) {
+    for (size_t i = 0; i < times; ++i) {
+        auto graph = builder.build();
+        ASSERT_EQ(0, graph->run(graph->find_data("A")).get());
+    }
+}
+
+// process返回后才记录耗时，可能晚于closure结束，等待统计生效
+template <typename C>
+static bool wait_until(C condition) {
+    for (size_t i = 0; i < 1000 && !condition(); ++i) {
+        ::std::this_thread::sleep_for(::std::chrono::milliseconds(1));
+    }
+    return condition();
+}
+
+TEST(graph, auto_trivial_promote_and_demote_by_cost) {
+    using ::joewu::feed::graph::GraphVertexCost;
+    DelayProcessor processor;
+    GraphBuilder builder;
+    RecordOrderExecutor executor;
+    builder.executor(executor);
+    // 1ms以内视为平凡，超过2ms降级
+    builder.auto_trivial(1000 * 1000);
+    {
+        auto& v = builder.add_vertex(processor);
+        v.name("A");
+        v.anonymous_emit().to("A");
+    }
+    ASSERT_EQ(0, builder.finish());
+    auto cost = builder.vertexes().front().cost();
+    ASSERT_NE(nullptr, cost);
+    ASSERT_FALSE(cost->cheap());
+
+    // 积累满一个窗口前仍然交给executor
+    order.clear();
+    run_delay_graph(builder, GraphVertexCost::WINDOW_SIZE);
+    ASSERT_EQ(GraphVertexCost::WINDOW_SIZE, order.size());
+    ASSERT_TRUE(wait_until([&] { return cost->cheap(); }));
+    order.clear();
+    run_delay_graph(builder, 1);
+    ASSERT_TRUE(order.empty());
+
+    // 变慢后退回executor调度
+    processor.delay_us = 3000;
+    run_delay_graph(builder, GraphVertexCost::WINDOW_SIZE);
+    ASSERT_TRUE(wait_until([&] { return !cost->cheap(); }));
+    ASSERT_LT(2000 * 1000, cost->p90());
+    order.clear();
+    run_delay_graph(builder, 1);
+    ASSERT_EQ(1, order.size());
+}
+
+TEST(graph, auto_trivial_evaluate_on_rolling_window) {
+    using ::joewu::feed::graph::GraphVertexCost;
+    DelayProcessor processor;
+    GraphBuilder builder;
+    RecordOrderExecutor executor;
+    builder.executor(executor);
+    builder.auto_trivial(1000 * 1000);
+    {
+        auto& v = builder.add_vertex(processor);
+        v.name("A");
+        v.anonymous_emit().to("A");
+    }
+    ASSERT_EQ(0, builder.finish());
+    auto cost = builder.vertexes().front().cost();
+    run_delay_graph(builder, GraphVertexCost::WINDOW_SIZE);
+    ASSERT_TRUE(wait_until([&] { return cost->cheap(); }));
+    // 不需要等满下一个窗口，最近的样本中慢的超过一成就降级
+    processor.delay_us = 3000;
+    run_delay_graph(builder, GraphVertexCost::WINDOW_SIZE / 10 + 1);
+    ASSERT_TRUE(wait_until([&] { return !cost->cheap(); }));
+}
+
+// 交给其他线程异步结束closure的算子
+class AsyncDoneProcessor : public GraphProcessor {
+public:
+    virtual void process(GraphVertex& vertex, GraphVertexClosure&& closure) noexcept override {
+        *vertex.anonymous_emit(0)->emit<int32_t>() = 1;
+        ::std::thread([] (GraphVertexClosure&& closure) {
+            closure.done(0);
+        }, ::std::move(closure)).detach();
+    }
+};
+
+// 以平凡方式运行的DelayProcessor
+class TrivialDelayProcessor : public DelayProcessor {
+public:
+    virtual int32_t setup(GraphVertex& vertex) const noexcept override {
+        vertex.trivial();
+        return 0;
+    }
+};
+
+TEST(graph, auto_trivial_exclude_asynchronous_processor) {
+    using ::joewu::feed::graph::GraphVertexCost;
+    AsyncDoneProcessor processor;
+    GraphBuilder builder;
+    builder.auto_trivial(1000 * 1000);
+    {
+        auto& v = builder.add_vertex(processor);
+        v.name("A");
+        v.anonymous_emit().to("A");
+    }
+    ASSERT_EQ(0, builder.finish());
+    auto cost = builder.vertexes().front().cost();
+    // process很快返回，但节点在其他线程结束，不能按平凡节点运行
+    for (size_t i = 0; i < GraphVertexCost::WINDOW_SIZE * 2; ++i) {
+        auto graph = builder.build();
+        auto closure = graph->run(graph->find_data("A"));
+        ASSERT_EQ(0, closure.get());
+        closure.wait();
+    }
+    ASSERT_FALSE(cost->cheap());
+}
+
+TEST(graph, auto_trivial_exclude_nested_inplace_successor) {
+    using ::joewu::feed::graph::GraphVertexCost;
+    DelayProcessor processor;
+    TrivialDelayProcessor slow_processor;
+    slow_processor.delay_us = 3000;
+    GraphBuilder builder;
+    RecordOrderExecutor executor;
+    builder.executor(executor);
+    builder.auto_trivial(1000 * 1000);
+    {
+        auto& v = builder.add_vertex(processor);
+        v.name("A");
+        v.anonymous_emit().to("A");
+    }
+    {
+        // 平凡的后继在A发布数据时同步运行，耗时不计入A
+        auto& v = builder.add_vertex(slow_processor);
+        v.name("B");
+        v.anonymous_depend().to("A");
+        v.anonymous_emit().to("B");
+    }
+    ASSERT_EQ(0, builder.finish());
+    auto cost = builder.vertexes().front().cost();
+    for (size_t i = 0; i < GraphVertexCost::WINDOW_SIZE; ++i) {
+        auto graph = builder.build();
+        ASSERT_EQ(0, graph->run(graph->find_data("B")).get());
+    }
+    ASSERT_TRUE(wait_until([&] { return cost->cheap(); }));
+}
+
+TEST(graph, auto_trivial_disabled_by_default) {
+    DelayProcessor processor;
+    GraphBuilder builder;
+    RecordOrderExecutor executor;
+    builder.executor(executor);
+    {
+        auto& v = builder.add_vertex(processor);
+        v.name("A");
+        v.anonymous_emit().to("A");
+    }
+    ASSERT_EQ(0, builder.finish());
+    ASSERT_EQ(nullptr, builder.vertexes().front().cost());
+    order.clear();
+    run_delay_graph(builder, 100);
+    ASSERT_EQ(100, order.size());
+}
+
+TEST(graph, closure_reusable_across_runs) {
+    ConstProcessor processor;
+    GraphBuilder builder;
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("A");
+    }
+    builder.finish();
+    auto graph = builder.build();
+    for (size_t i = 0; i < 10; ++i) {
+        graph->reset();
+        ASSERT_EQ(0, graph->run(graph->find_data("A")).get());
+        ASSERT_EQ(10086, *graph->find_data("A")->cvalue<int32_t>());
+    }
+    // 上一次的closure仍被持有时，新的运行使用独立的closure
+    graph->reset();
+    auto first = graph->run(graph->find_data("A"));
+    ASSERT_EQ(0, first.get());
+    graph->reset();
+    auto second = graph->run(graph->find_data("A"));
+    ASSERT_EQ(0, second.get());
+    ASSERT_EQ(0, first.error_code());
+    // on_finish回调结束后closure归还，可以继续复用
+    graph->reset();
+    ::std::promise<int32_t> promise;
+    auto future = promise.get_future();
+    graph->run(graph->find_data("A")).on_finish([&] (Closure&& closure) {
+        closure.wait();
+        promise.set_value(closure.error_code());
+    });
+    ASSERT_EQ(0, future.get());
+}
+
+TEST(graph, closure_outlive_graph) {
+    ConstProcessor processor;
+    GraphBuilder builder;
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("A");
+    }
+    builder.finish();
+    Closure closure;
+    {
+        auto graph = builder.build();
+        closure = graph->run(graph->find_data("A"));
+        closure.wait();
+    }
+    ASSERT_EQ(0, closure.error_code());
+}
+
+TEST(graph, wait_for_timeout_and_cancel_skip_pending_vertexes) {
+    DelayProcessor slow_processor;
+    slow_processor.delay_us = 200 * 1000;
+    DelayProcessor fast_processor;
+    GraphBuilder builder;
+    {
+        auto& v = builder.add_vertex(fast_processor);
+        v.anonymous_emit().to("A");
+        v.anonymous_depend().to("B");
+    }
+    {
+        auto& v = builder.add_vertex(fast_processor);
+        v.anonymous_emit().to("B");
+        v.anonymous_depend().to("C");
+    }
+    {
+        auto& v = builder.add_vertex(slow_processor);
+        v.anonymous_emit().to("C");
+    }
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    auto closure = graph->run(graph->find_data("A"));
+    int32_t error_code = 0;
+    ASSERT_FALSE(closure.get_for(::std::chrono::milliseconds(10), error_code));
+    ASSERT_FALSE(closure.wait_for(::std::chrono::milliseconds(10)));
+    closure.cancel(-10086);
+    // 取消后立即进入终止态
+    ASSERT_TRUE(closure.get_for(::std::chrono::milliseconds(0), error_code));
+    ASSERT_EQ(-10086, error_code);
+    // 运行中的节点完成后进入稳态，后续节点不再运行
+    ASSERT_TRUE(closure.wait_for(::std::chrono::seconds(10)));
+    ASSERT_EQ(1, slow_processor.run_times.load());
+    ASSERT_EQ(0, fast_processor.run_times.load());
+    ASSERT_TRUE(graph->find_data("B")->ready());
+    ASSERT_TRUE(graph->find_data("B")->empty());
+    ASSERT_TRUE(graph->find_data("A")->empty());
+
+    // 重用后不再处于取消状态
+    graph->reset();
+    slow_processor.delay_us = 0;
+    ASSERT_EQ(0, graph->run(graph->find_data("A")).get());
+    ASSERT_EQ(2, fast_processor.run_times.load());
+}
+
+// 对已就绪的依赖求和，缺失的依赖视为0
+class PartialSumProcessor : public GraphProcessor {
+public:
+    virtual int32_t process(GraphVertex& vertex) noexcept override {
+        int32_t sum = 0;
+        for (size_t i = 0; i < vertex.anonymous_dependency_size(); ++i) {
+            auto value = vertex.anonymous_dependency(i)->value<int32_t>();
+            if (value != nullptr) {
+                sum += *value;
+            }
+        }
+        *vertex.anonymous_emit(0)->emit<int32_t>() = sum;
+        run_times++;
+        return 0;
+    }
+
+    ::std::atomic<size_t> run_times {0};
+};
+
+TEST(graph, shed_non_essential_branch_after_deadline) {
+    DelayProcessor slow_processor;
+    slow_processor.delay_us = 100 * 1000;
+    PartialSumProcessor optional_processor;
+    PartialSumProcessor merge_processor;
+    GraphBuilder builder;
+    {
+        auto& v = builder.add_vertex(merge_processor);
+        v.anonymous_emit().to("A");
+        v.anonymous_depend().to("R").set_essential();
+        v.anonymous_depend().to("O");
+    }
+    {
+        auto& v = builder.add_vertex(optional_processor);
+        v.anonymous_emit().to("O");
+        v.anonymous_depend().to("R");
+    }
+    {
+        auto& v = builder.add_vertex(slow_processor);
+        v.anonymous_emit().to("R");
+    }
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    // 超时后R的可选后继被舍弃，merge使用已就绪的R继续运行
+    graph->deadline(::std::chrono::steady_clock::now() + ::std::chrono::milliseconds(20));
+    ASSERT_EQ(0, graph->run(graph->find_data("A")).get());
+    ASSERT_EQ(1, *graph->find_data("A")->cvalue<int32_t>());
+    ASSERT_TRUE(graph->find_data("O")->empty());
+    ASSERT_EQ(0, optional_processor.run_times.load());
+    ASSERT_EQ(1, merge_processor.run_times.load());
+
+    // reset清除deadline，全部节点正常运行
+    graph->reset();
+    ASSERT_EQ(0, graph->run(graph->find_data("A")).get());
+    ASSERT_EQ(2, *graph->find_data("A")->cvalue<int32_t>());
+    ASSERT_EQ(1, optional_processor.run_times.load());
+}
+
+// 全部产出都输出依赖之和
+class MultiEmitProcessor : public GraphProcessor {
+public:
+    virtual int32_t process(GraphVertex& vertex) noexcept override {
+        int32_t sum = 0;
+        for (size_t i = 0; i < vertex.anonymous_dependency_size(); ++i) {
+            auto value = vertex.anonymous_dependency(i)->value<int32_t>();
+            if (value != nullptr) {
+                sum += *value;
+            }
+        }
+        for (size_t i = 0; i < vertex.anonymous_emit_size(); ++i) {
+            *vertex.anonymous_emit(i)->emit<int32_t>() = sum;
+        }
+        run_times++;
+        return 0;
+    }
+
+    ::std::atomic<size_t> run_times {0};
+};
+
+TEST(graph, not_shed_vertex_with_unconsumed_emit) {
+    DelayProcessor slow_processor;
+    slow_processor.delay_us = 100 * 1000;
+    MultiEmitProcessor optional_processor;
+    PartialSumProcessor merge_processor;
+    GraphBuilder builder;
+    {
+        auto& v = builder.add_vertex(merge_processor);
+        v.anonymous_emit().to("A");
+        v.anonymous_depend().to("R").set_essential();
+        v.anonymous_depend().to("O");
+    }
+    {
+        // X没有消费者，是图的结果，整个节点都不能舍弃
+        auto& v = builder.add_vertex(optional_processor);
+        v.anonymous_emit().to("O");
+        v.anonymous_emit().to("X");
+        v.anonymous_depend().to("R");
+    }
+    {
+        auto& v = builder.add_vertex(slow_processor);
+        v.anonymous_emit().to("R");
+    }
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    graph->deadline(::std::chrono::steady_clock::now() + ::std::chrono::milliseconds(20));
+    ASSERT_EQ(0, graph->run(graph->find_data("A")).get());
+    ASSERT_EQ(1, optional_processor.run_times.load());
+    ASSERT_EQ(1, *graph->find_data("X")->cvalue<int32_t>());
+    ASSERT_EQ(2, *graph->find_data("A")->cvalue<int32_t>());
+}
+
+TEST(graph, not_shed_vertex_whose_emit_is_requested) {
+    DelayProcessor slow_processor;
+    slow_processor.delay_us = 100 * 1000;
+    PartialSumProcessor optional_processor;
+    PartialSumProcessor merge_processor;
+    GraphBuilder builder;
+    {
+        auto& v = builder.add_vertex(merge_processor);
+        v.anonymous_emit().to("A");
+        v.anonymous_depend().to("R").set_essential();
+        v.anonymous_depend().to("O");
+    }
+    {
+        auto& v = builder.add_vertex(optional_processor);
+        v.anonymous_emit().to("O");
+        v.anonymous_depend().to("R");
+    }
+    {
+        auto& v = builder.add_vertex(slow_processor);
+        v.anonymous_emit().to("R");
+    }
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    // O同时被直接请求，超时后也需要运行
+    graph->deadline(::std::chrono::steady_clock::now() + ::std::chrono::milliseconds(20));
+    ASSERT_EQ(0, graph->run(graph->find_data("A"), graph->find_data("O")).get());
+    ASSERT_EQ(1, optional_processor.run_times.load());
+    ASSERT_EQ(1, *graph->find_data("O")->cvalue<int32_t>());
+    ASSERT_EQ(2, *graph->find_data("A")->cvalue<int32_t>());
+}
+
+class CountResetProcessor : public GraphProcessor {
+    virtual int32_t process(GraphVertex& vertex) noexcept override {
+        *vertex.anonymous_emit(0)->emit<int32_t>() = 1;
+        return 0;
+    }
+    virtual void reset(GraphVertex&) const noexcept override {
+        reset_num.fetch_add(1, ::std::memory_order_relaxed);
+    }
+public:
+    mutable ::std::atomic<size_t> reset_num {0};
+};
+
+TEST(graph, reset_only_touched_vertexes) {
+    CountResetProcessor processor;
+    GraphBuilder builder;
+    // A <- B 和 C <- D 两条互不相关的链路
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("A");
+        v.anonymous_depend().to("B");
+    }
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("B");
+    }
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("C");
+        v.anonymous_depend().to("D");
+    }
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("D");
+    }
+    builder.finish();
+    auto graph = builder.build();
+    // 未运行时没有需要重置的vertex
+    graph->reset();
+    ASSERT_EQ(0, processor.reset_num.load());
+    // 只运行A链路，reset只触及A链路上的两个vertex
+    ASSERT_EQ(0, graph->run(graph->find_data("A")).get());
+    graph->reset();
+    ASSERT_EQ(2, processor.reset_num.load());
+    ASSERT_FALSE(graph->find_data("A")->ready());
+    ASSERT_FALSE(graph->find_data("B")->ready());
+    // 外部直接发布的data同样会被重置
+    processor.reset_num = 0;
+    *graph->find_data("D")->emit<int32_t>() = 2;
+    ASSERT_EQ(0, graph->run(graph->find_data("C")).get());
+    ASSERT_EQ(1, *graph->find_data("C")->cvalue<int32_t>());
+    graph->reset();
+    ASSERT_EQ(2, processor.reset_num.load());
+    ASSERT_FALSE(graph->find_data("D")->ready());
+    // 重置后两条链路都可以再次完整运行
+    ASSERT_EQ(0, graph->run(graph->find_data("A"), graph->find_data("C")).get());
+    ASSERT_EQ(1, *graph->find_data("A")->cvalue<int32_t>());
+    ASSERT_EQ(1, *graph->find_data("D")->cvalue<int32_t>());
+}
+
+TEST(graph, instances_share_plan_from_same_builder) {
+    ConstProcessor processor;
+    GraphBuilder builder;
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("A");
+    }
+    // finish之前没有可用的plan，无法build
+    ASSERT_FALSE(builder.build());
+    builder.finish();
+    auto first = builder.build();
+    auto second = builder.build();
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    // 名字等静态信息只有一份
+    ASSERT_EQ(&first->find_data("A")->name(), &second->find_data("A")->name());
+    ASSERT_EQ("A", first->find_data("A")->name());
+    ASSERT_EQ(nullptr, first->find_data("B"));
+    // 运行状态仍然相互独立
+    ASSERT_EQ(0, first->run(first->find_data("A")).get());
+    ASSERT_TRUE(first->find_data("A")->ready());
+    ASSERT_FALSE(second->find_data("A")->ready());
+}
+
+TEST(graph, data_handle_valid_for_all_instances) {
+    ConstProcessor processor;
+    GraphBuilder builder;
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("A");
+    }
+    builder.finish();
+    auto handle = builder.data_handle("A");
+    ASSERT_TRUE(handle);
+    ASSERT_FALSE(builder.data_handle("B"));
+    auto first = builder.build();
+    auto second = builder.build();
+    ASSERT_EQ(first->find_data("A"), first->find_data(handle));
+    ASSERT_EQ(second->find_data("A"), second->find_data(handle));
+    ASSERT_EQ(nullptr, first->find_data(builder.data_handle("B")));
+    ASSERT_EQ(0, second->run(second->find_data(handle)).get());
+    ASSERT_EQ(10086, *second->find_data(handle)->cvalue<int32_t>());
+}
+
+TEST(graph, invalidate_rerun_only_downstream_cone) {
+    PartialSumProcessor x_processor;
+    PartialSumProcessor y_processor;
+    PartialSumProcessor z_processor;
+    GraphBuilder builder;
+    // Z <- {X <- P, Y <- Q}
+    {
+        auto& v = builder.add_vertex(z_processor);
+        v.anonymous_emit().to("Z");
+        v.anonymous_depend().to("X");
+        v.anonymous_depend().to("Y");
+    }
+    {
+        auto& v = builder.add_vertex(x_processor);
+        v.anonymous_emit().to("X");
+        v.anonymous_depend().to("P");
+    }
+    {
+        auto& v = builder.add_vertex(y_processor);
+        v.anonymous_emit().to("Y");
+        v.anonymous_depend().to("Q");
+    }
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    auto p = graph->find_data("P");
+    auto q = graph->find_data("Q");
+    auto z = graph->find_data("Z");
+    *p->emit<int32_t>() = 1;
+    *q->emit<int32_t>() = 2;
+    ASSERT_EQ(0, graph->run(z).get());
+    ASSERT_EQ(3, *z->cvalue<int32_t>());
+
+    // 只有P的下游X和Z失效，Y保持就绪
+    ASSERT_EQ(0, graph->invalidate(p));
+    ASSERT_FALSE(p->ready());
+    ASSERT_FALSE(graph->find_data("X")->ready());
+    ASSERT_FALSE(z->ready());
+    ASSERT_TRUE(graph->find_data("Y")->ready());
+    *p->emit<int32_t>() = 10;
+    ASSERT_EQ(0, graph->run(z).get());
+    ASSERT_EQ(12, *z->cvalue<int32_t>());
+    ASSERT_EQ(2, x_processor.run_times.load());
+    ASSERT_EQ(1, y_processor.run_times.load());
+    ASSERT_EQ(2, z_processor.run_times.load());
+
+    // 可以连续增量运行，reset后恢复完整运行
+    ASSERT_EQ(0, graph->invalidate(q));
+    *q->emit<int32_t>() = 20;
+    ASSERT_EQ(0, graph->run(z).get());
+    ASSERT_EQ(30, *z->cvalue<int32_t>());
+    ASSERT_EQ(2, x_processor.run_times.load());
+    ASSERT_EQ(2, y_processor.run_times.load());
+    graph->reset();
+    *p->emit<int32_t>() = 1;
+    *q->emit<int32_t>() = 2;
+    ASSERT_EQ(0, graph->run(z).get());
+    ASSERT_EQ(3, *z->cvalue<int32_t>());
+    ASSERT_EQ(3, x_processor.run_times.load());
+    ASSERT_EQ(3, y_processor.run_times.load());
+}
+
+TEST(graph, invalidate_refuse_mutable_depend_out_of_cone) {
+    PartialSumProcessor processor;
+    GraphBuilder builder;
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("Z");
+        v.anonymous_depend().to("P");
+        v.anonymous_depend().to("Q").set_mutable();
+    }
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    auto p = graph->find_data("P");
+    auto q = graph->find_data("Q");
+    auto z = graph->find_data("Z");
+    *p->emit<int32_t>() = 1;
+    *q->emit<int32_t>() = 2;
+    ASSERT_EQ(0, graph->run(z).get());
+    // Q可能已经被修改，只失效P时拒绝
+    ASSERT_NE(0, graph->invalidate(p));
+    ASSERT_TRUE(p->ready());
+    ASSERT_TRUE(z->ready());
+    // Q一同重新发布时允许
+    ASSERT_EQ(0, graph->invalidate(p, q));
+    *p->emit<int32_t>() = 3;
+    *q->emit<int32_t>() = 4;
+    ASSERT_EQ(0, graph->run(z).get());
+    ASSERT_EQ(7, *z->cvalue<int32_t>());
+}
@@ -0,0 +1,236 @@
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <gtest/gtest.h>
+#include <base/logging.h>
+#include <joewu/graph/engine/graph.h>
+#include <joewu/graph/engine/graph_pool.h>
+#include <joewu/graph/engine/data.h>
+#include <joewu/graph/engine/vertex.h>
+#include <joewu/graph/engine/builder.h>
+#include <joewu/graph/engine/closure.h>
+#include "sum_processor.h"
+
+using ::joewu::feed::graph::Graph;
+using ::joewu::feed::graph::GraphBuilder;
+using ::joewu::feed::graph::GraphPool;
+using ::joewu::feed::graph::GraphProcessor;
+using ::joewu::feed::graph::GraphVertex;
+using ::joewu::feed::graph::PooledGraph;
+
+class GraphPoolTest : public ::testing::Test {
+public:
+    virtual void SetUp() {
+        build_pair(builder, processor);
+        ASSERT_EQ(0, builder.finish());
+    }
+
+    SumProcessor processor;
+    GraphBuilder builder;
+};
+
+TEST_F(GraphPoolTest, reuse_returned_instance_after_reset) {
+    GraphPool pool(builder);
+    Graph* first = nullptr;
+    {
+        auto graph = pool.acquire();
+        ASSERT_TRUE(graph);
+        first = graph.get();
+        ASSERT_EQ(0, graph->run(graph->find_data("A")).get());
+        ASSERT_EQ(2, *graph->find_data("A")->cvalue<int32_t>());
+    }
+    ASSERT_EQ(0, pool.hit_num());
+    ASSERT_EQ(1, pool.miss_num());
+    ASSERT_EQ(1, pool.created_num());
+    {
+        // 同一线程取回刚归还的实例，且已经reset
+        auto graph = pool.acquire();
+        ASSERT_EQ(first, graph.get());
+        ASSERT_FALSE(graph->find_data("A")->ready());
+        ASSERT_EQ(0, graph->run(graph->find_data("A")).get());
+        ASSERT_EQ(2, *graph->find_data("A")->cvalue<int32_t>());
+    }
+    ASSERT_EQ(1, pool.hit_num());
+    ASSERT_EQ(1, pool.created_num());
+}
+
+TEST_F(GraphPoolTest, grow_on_demand_up_to_capacity) {
+    GraphPool pool(builder, 2);
+    auto first = pool.acquire();
+    auto second = pool.acquire();
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    ASSERT_NE(first.get(), second.get());
+    auto third = pool.acquire();
+    ASSERT_FALSE(third);
+    ASSERT_EQ(3, pool.miss_num());
+    ASSERT_EQ(2, pool.created_num());
+    first.reset();
+    third = pool.acquire();
+    ASSERT_TRUE(third);
+    ASSERT_EQ(1, pool.hit_num());
+}
+
+TEST_F(GraphPoolTest, take_idle_instance_cached_by_other_thread) {
+    GraphPool pool(builder, 4);
+    {
+        ::std::vector<PooledGraph> graphs;
+        for (size_t i = 0; i < 4; ++i) {
+            graphs.emplace_back(pool.acquire());
+            ASSERT_TRUE(graphs.back());
+        }
+        // 全部归还到当前线程的本地槽位
+    }
+    ASSERT_EQ(4, pool.created_num());
+    bool success = false;
+    ::std::thread([&] {
+        auto graph = pool.acquire();
+        success = graph && 0 == graph->run(graph->find_data("A")).get()
+            && 2 == *graph->find_data("A")->cvalue<int32_t>();
+    }).join();
+    ASSERT_TRUE(success);
+    ASSERT_EQ(4, pool.created_num());
+}
+
+TEST_F(GraphPoolTest, reserve_ahead_and_overflow_to_shared_list) {
+    GraphPool pool(builder, 0, 1);
+    ASSERT_EQ(3, pool.reserve(3));
+    {
+        ::std::vector<PooledGraph> graphs;
+        for (size_t i = 0; i < 3; ++i) {
+            graphs.emplace_back(pool.acquire());
+        }
+        // 归还时本地槽位只能放下一个，其余进入共享列表
+    }
+    for (size_t i = 0; i < 3; ++i) {
+        ASSERT_TRUE(pool.acquire());
+    }
+    ASSERT_EQ(6, pool.hit_num());
+    ASSERT_EQ(0, pool.miss_num());
+    ASSERT_EQ(3, pool.created_num());
+}
+
+TEST_F(GraphPoolTest, concurrent_acquire_and_release) {
+    GraphPool pool(builder, 8);
+    ::std::atomic<size_t> success {0};
+    ::std::vector<::std::thread> threads;
+    for (size_t i = 0; i < 4; ++i) {
+        threads.emplace_back([&] {
+            for (size_t j = 0; j < 100; ++j) {
+                auto graph = pool.acquire();
+                if (graph && 0 == graph->run(graph->find_data("A")).get()
+                        && 2 == *graph->find_data("A")->cvalue<int32_t>()) {
+                    success++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(400, success.load());
+    ASSERT_GE(4, pool.created_num());
+    ASSERT_EQ(400, pool.hit_num() + pool.miss_num());
+}
+
+// 记录reset所在的线程
+class RecordResetProcessor : public SumProcessor {
+public:
+    virtual void reset(GraphVertex&) const noexcept override {
+        ::std::lock_guard<::std::mutex> lock(mutex);
+        reset_thread_ids.emplace_back(::std::this_thread::get_id());
+    }
+
+    mutable ::std::mutex mutex;
+    mutable ::std::vector<::std::thread::id> reset_thread_ids;
+};
+
+TEST(graph_pool, background_reset_off_request_thread) {
+    RecordResetProcessor processor;
+    GraphBuilder builder;
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("A");
+    }
+    ASSERT_EQ(0, builder.finish());
+    GraphPool pool(builder);
+    pool.background_reset();
+    {
+        auto graph = pool.acquire();
+        ASSERT_EQ(0, graph->run(graph->find_data("A")).get());
+    }
+    // 等待后台reset完成后放回共享列表
+    for (size_t i = 0; i < 10000; ++i) {
+        {
+            ::std::lock_guard<::std::mutex> lock(processor.mutex);
+            if (!processor.reset_thread_ids.empty()) {
+                break;
+            }
+        }
+        usleep(1000);
+    }
+    {
+        ::std::lock_guard<::std::mutex> lock(processor.mutex);
+        ASSERT_EQ(1, processor.reset_thread_ids.size());
+        ASSERT_NE(::std::this_thread::get_id(), processor.reset_thread_ids[0]);
+    }
+    for (size_t i = 0; i < 1000 && pool.hit_num() == 0; ++i) {
+        auto graph = pool.acquire();
+        if (pool.hit_num() > 0) {
+            ASSERT_FALSE(graph->find_data("A")->ready());
+        }
+    }
+    ASSERT_EQ(1, pool.hit_num());
+}
+
+TEST(graph_pool, reset_inplace_when_reach_capacity) {
+    RecordResetProcessor processor;
+    GraphBuilder builder;
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("A");
+    }
+    ASSERT_EQ(0, builder.finish());
+    GraphPool pool(builder, 1);
+    pool.background_reset();
+    // 唯一的实例可能正在后台reset，此时等待完成而不是返回空
+    for (size_t i = 0; i < 1000; ++i) {
+        auto graph = pool.acquire();
+        ASSERT_TRUE(graph);
+        ASSERT_FALSE(graph->find_data("A")->ready());
+        ASSERT_EQ(0, graph->run(graph->find_data("A")).get());
+    }
+    ASSERT_EQ(1, pool.created_num());
+}
+
+// reset较慢，用于构造后台线程正在reset的窗口
+class SlowResetProcessor : public SumProcessor {
+public:
+    virtual void reset(GraphVertex&) const noexcept override {
+        usleep(20000);
+    }
+};
+
+TEST(graph_pool, wait_inflight_reset_when_reach_capacity) {
+    SlowResetProcessor processor;
+    GraphBuilder builder;
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("A");
+    }
+    ASSERT_EQ(0, builder.finish());
+    GraphPool pool(builder, 1);
+    pool.background_reset();
+    for (size_t i = 0; i < 10; ++i) {
+        {
+            auto graph = pool.acquire();
+            ASSERT_TRUE(graph);
+            ASSERT_FALSE(graph->find_data("A")->ready());
+            ASSERT_EQ(0, graph->run(graph->find_data("A")).get());
+        }
+        // 让后台线程先取走归还的实例
+        usleep(2000);
+    }
+    ASSERT_EQ(1, pool.created_num());
+}
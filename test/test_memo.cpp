@@ -0,0 +1,257 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <gtest/gtest.h>
+#include <base/logging.h>
+#include <joewu/graph/engine/graph.h>
+#include <joewu/graph/engine/data.h>
+#include <joewu/graph/engine/vertex.h>
+#include <joewu/graph/engine/builder.h>
+#include <joewu/graph/engine/closure.h>
+#include <joewu/graph/engine/memo.h>
+
+using ::joewu::feed::mlarch::babylon::Any;
+using ::joewu::feed::graph::Graph;
+using ::joewu::feed::graph::GraphBuilder;
+using ::joewu::feed::graph::GraphProcessor;
+using ::joewu::feed::graph::GraphVertex;
+using ::joewu::feed::graph::GraphVertexMemo;
+using ::joewu::feed::graph::GraphMemoHasher;
+using ::joewu::feed::graph::GraphMemoEqual;
+
+// 输出依赖字符串的长度，记录运行次数
+class LengthProcessor : public GraphProcessor {
+public:
+    virtual int32_t process(GraphVertex& vertex) noexcept override {
+        auto value = vertex.anonymous_dependency(0)->value<::std::string>();
+        if (value == nullptr) {
+            return -1;
+        }
+        *vertex.anonymous_emit(0)->emit<int32_t>() = value->size();
+        run_times++;
+        return 0;
+    }
+
+    ::std::atomic<size_t> run_times {0};
+};
+
+struct Point {
+    int32_t x;
+};
+
+// 输出依赖Point的x
+class PointProcessor : public GraphProcessor {
+public:
+    virtual int32_t process(GraphVertex& vertex) noexcept override {
+        auto value = vertex.anonymous_dependency(0)->value<Point>();
+        if (value == nullptr) {
+            return -1;
+        }
+        *vertex.anonymous_emit(0)->emit<int32_t>() = value->x;
+        run_times++;
+        return 0;
+    }
+
+    ::std::atomic<size_t> run_times {0};
+};
+
+static int32_t run_once(GraphBuilder& builder, const ::std::string& input) {
+    auto graph = builder.build();
+    *graph->find_data("A")->emit<::std::string>() = input;
+    auto b = graph->find_data("B");
+    if (0 != graph->run(b).get()) {
+        return -1;
+    }
+    return *b->cvalue<int32_t>();
+}
+
+TEST(memo, hit_across_graph_instances) {
+    LengthProcessor processor;
+    GraphBuilder builder;
+    auto& vertex = builder.add_vertex(processor).memo(16);
+    vertex.anonymous_emit().to("B");
+    vertex.anonymous_depend().to("A");
+    ASSERT_EQ(0, builder.finish());
+    ASSERT_NE(nullptr, vertex.memo());
+
+    ASSERT_EQ(3, run_once(builder, "abc"));
+    ASSERT_EQ(1, processor.run_times.load());
+    // 相同输入在新的实例中命中，不再运行process
+    ASSERT_EQ(3, run_once(builder, "abc"));
+    ASSERT_EQ(1, processor.run_times.load());
+    ASSERT_EQ(1, vertex.memo()->hit_num());
+    // 不同输入重新计算
+    ASSERT_EQ(5, run_once(builder, "abcde"));
+    ASSERT_EQ(2, processor.run_times.load());
+    ASSERT_EQ(2, vertex.memo()->size());
+}
+
+TEST(memo, hit_after_graph_reset) {
+    LengthProcessor processor;
+    GraphBuilder builder;
+    auto& vertex = builder.add_vertex(processor).memo(16);
+    vertex.anonymous_emit().to("B");
+    vertex.anonymous_depend().to("A");
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    auto a = graph->find_data("A");
+    auto b = graph->find_data("B");
+    for (size_t i = 0; i < 3; ++i) {
+        graph->reset();
+        *a->emit<::std::string>() = "ab";
+        ASSERT_EQ(0, graph->run(b).get());
+        ASSERT_EQ(2, *b->cvalue<int32_t>());
+    }
+    ASSERT_EQ(1, processor.run_times.load());
+    // 命中时以常量引用发布
+    ASSERT_EQ(nullptr, b->mutable_value<int32_t>());
+}
+
+TEST(memo, bounded_by_capacity) {
+    LengthProcessor processor;
+    GraphBuilder builder;
+    auto& vertex = builder.add_vertex(processor).memo(1);
+    vertex.anonymous_emit().to("B");
+    vertex.anonymous_depend().to("A");
+    ASSERT_EQ(0, builder.finish());
+    ::std::string input;
+    for (size_t i = 0; i < 10 * GraphVertexMemo::SHARD_NUM; ++i) {
+        input.push_back('a');
+        ASSERT_EQ(static_cast<int32_t>(input.size()), run_once(builder, input));
+    }
+    // 容量小于分片数时减少分片，总条目数不超过capacity
+    ASSERT_EQ(1, vertex.memo()->size());
+
+    LengthProcessor wide_processor;
+    GraphBuilder wide_builder;
+    auto& wide_vertex = wide_builder.add_vertex(wide_processor).memo(20);
+    wide_vertex.anonymous_emit().to("B");
+    wide_vertex.anonymous_depend().to("A");
+    ASSERT_EQ(0, wide_builder.finish());
+    input.clear();
+    for (size_t i = 0; i < 10 * GraphVertexMemo::SHARD_NUM; ++i) {
+        input.push_back('a');
+        ASSERT_EQ(static_cast<int32_t>(input.size()), run_once(wide_builder, input));
+    }
+    ASSERT_GE(20, wide_vertex.memo()->size());
+}
+
+TEST(memo, key_distinguish_empty_and_type) {
+    GraphVertexMemo memo(16, ::std::chrono::nanoseconds(0),
+        GraphMemoHasher(), GraphMemoEqual());
+    uint64_t empty_key = 0;
+    ASSERT_TRUE(memo.combine(empty_key, nullptr));
+    // 空依赖和hash为0的值不再得到相同的key
+    Any zero(static_cast<int32_t>(0));
+    uint64_t zero_key = 0;
+    ASSERT_TRUE(memo.combine(zero_key, &zero));
+    ASSERT_NE(empty_key, zero_key);
+    // 值相同类型不同时key不同
+    Any int32_value(static_cast<int32_t>(3));
+    Any int64_value(static_cast<int64_t>(3));
+    uint64_t int32_key = 0;
+    uint64_t int64_key = 0;
+    ASSERT_TRUE(memo.combine(int32_key, &int32_value));
+    ASSERT_TRUE(memo.combine(int64_key, &int64_value));
+    ASSERT_NE(int32_key, int64_key);
+}
+
+TEST(memo, hash_collision_verified_by_equal) {
+    LengthProcessor processor;
+    GraphBuilder builder;
+    auto& vertex = builder.add_vertex(processor).memo(16);
+    vertex.anonymous_emit().to("B");
+    vertex.anonymous_depend().to("A");
+    // 所有值都冲突到同一个hash
+    vertex.memo_hasher([] (const Any&, uint64_t& hash) {
+        hash = 0;
+        return true;
+    }, GraphVertexMemo::default_equal);
+    ASSERT_EQ(0, builder.finish());
+    ASSERT_EQ(3, run_once(builder, "abc"));
+    // 冲突时比较依赖值，视为未命中重新计算
+    ASSERT_EQ(5, run_once(builder, "abcde"));
+    ASSERT_EQ(2, processor.run_times.load());
+    ASSERT_EQ(5, run_once(builder, "abcde"));
+    ASSERT_EQ(2, processor.run_times.load());
+    ASSERT_EQ(3, run_once(builder, "abc"));
+    ASSERT_EQ(3, processor.run_times.load());
+}
+
+TEST(memo, expire_after_ttl) {
+    LengthProcessor processor;
+    GraphBuilder builder;
+    auto& vertex = builder.add_vertex(processor)
+        .memo(16, ::std::chrono::milliseconds(50));
+    vertex.anonymous_emit().to("B");
+    vertex.anonymous_depend().to("A");
+    ASSERT_EQ(0, builder.finish());
+    ASSERT_EQ(1, run_once(builder, "a"));
+    ASSERT_EQ(1, run_once(builder, "a"));
+    ASSERT_EQ(1, processor.run_times.load());
+    ::std::this_thread::sleep_for(::std::chrono::milliseconds(100));
+    ASSERT_EQ(1, run_once(builder, "a"));
+    ASSERT_EQ(2, processor.run_times.load());
+    // 过期后重新写入
+    ASSERT_EQ(1, run_once(builder, "a"));
+    ASSERT_EQ(2, processor.run_times.load());
+    ASSERT_EQ(1, vertex.memo()->size());
+}
+
+TEST(memo, unhashable_dependency_use_custom_hasher) {
+    PointProcessor processor;
+    GraphBuilder builder;
+    auto& vertex = builder.add_vertex(processor).memo(16);
+    vertex.anonymous_emit().to("B");
+    vertex.anonymous_depend().to("A");
+    ASSERT_EQ(0, builder.finish());
+    auto run = [&] (int32_t x) {
+        auto graph = builder.build();
+        graph->find_data("A")->emit<Point>()->x = x;
+        auto b = graph->find_data("B");
+        graph->run(b).get();
+        return *b->cvalue<int32_t>();
+    };
+    // 默认hasher无法处理时每次都运行
+    ASSERT_EQ(1, run(1));
+    ASSERT_EQ(1, run(1));
+    ASSERT_EQ(2, processor.run_times.load());
+    ASSERT_EQ(0, vertex.memo()->size());
+
+    vertex.memo_hasher([] (const Any& value, uint64_t& hash) {
+        auto point = value.cget<Point>();
+        if (point == nullptr) {
+            return false;
+        }
+        hash = point->x;
+        return true;
+    }, [] (const Any& left, const Any& right) {
+        return left.cget<Point>()->x == right.cget<Point>()->x;
+    });
+    ASSERT_EQ(0, builder.finish());
+    ASSERT_EQ(1, run(1));
+    ASSERT_EQ(1, run(1));
+    ASSERT_EQ(2, run(2));
+    ASSERT_EQ(4, processor.run_times.load());
+}
+
+TEST(memo, disabled_when_emit_mutable_depended) {
+    LengthProcessor processor;
+    LengthProcessor consumer;
+    GraphBuilder builder;
+    {
+        auto& vertex = builder.add_vertex(processor).memo(16);
+        vertex.anonymous_emit().to("B");
+        vertex.anonymous_depend().to("A");
+    }
+    {
+        auto& vertex = builder.add_vertex(consumer);
+        vertex.anonymous_emit().to("C");
+        vertex.anonymous_depend().to("B").set_mutable();
+    }
+    ASSERT_EQ(0, builder.finish());
+    ASSERT_EQ(2, run_once(builder, "ab"));
+    ASSERT_EQ(2, run_once(builder, "ab"));
+    ASSERT_EQ(2, processor.run_times.load());
+}
@@ -0,0 +1,141 @@
+#include <thread>
+#include <atomic>
+#include <string>
+#include <inttypes.h>
+#include <gtest/gtest.h>
+#include <base/logging.h>
+#include <joewu/graph/engine/graph.h>
+#include <joewu/graph/engine/data.h>
+#include <joewu/graph/engine/vertex.h>
+#include <joewu/graph/engine/builder.h>
+#include <joewu/graph/engine/closure.h>
+#include <joewu/graph/engine/serial_executor.h>
+#include "sum_processor.h"
+
+using ::joewu::feed::graph::GraphBuilder;
+using ::joewu::feed::graph::GraphProcessor;
+using ::joewu::feed::graph::GraphVertex;
+using ::joewu::feed::graph::Closure;
+using ::joewu::feed::graph::SerialGraphExecutor;
+
+// 所有依赖求和加一后输出，并记录运行线程
+class ThreadSumProcessor : public SumProcessor {
+public:
+    virtual int32_t process(GraphVertex& vertex) noexcept override {
+        if (::std::this_thread::get_id() != thread_id) {
+            other_thread_num++;
+        }
+        return SumProcessor::process(vertex);
+    }
+
+    ::std::thread::id thread_id {::std::this_thread::get_id()};
+    ::std::atomic<size_t> other_thread_num {0};
+};
+
+static void build_serial_diamond(GraphBuilder& builder, GraphProcessor& processor) {
+    builder.executor(SerialGraphExecutor::instance());
+    build_diamond(builder, processor);
+}
+
+TEST(serial_executor, finished_when_run_return) {
+    ThreadSumProcessor processor;
+    GraphBuilder builder;
+    build_serial_diamond(builder, processor);
+    ASSERT_EQ(0, builder.finish());
+    for (size_t i = 0; i < 10; ++i) {
+        auto graph = builder.build();
+        auto a = graph->find_data("A");
+        auto closure = graph->run(a);
+        ASSERT_TRUE(closure.finished());
+        ASSERT_EQ(0, closure.error_code());
+        ASSERT_EQ(5, *a->cvalue<int32_t>());
+    }
+    ASSERT_EQ(0, processor.other_thread_num.load());
+}
+
+TEST(serial_executor, on_finish_run_after_all_vertex) {
+    ThreadSumProcessor processor;
+    GraphBuilder builder;
+    build_serial_diamond(builder, processor);
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    auto a = graph->find_data("A");
+    bool called = false;
+    int32_t value = 0;
+    graph->run(a).on_finish([&] (Closure&& closure) {
+        closure.wait();
+        called = true;
+        value = *a->cvalue<int32_t>();
+    });
+    ASSERT_TRUE(called);
+    ASSERT_EQ(5, value);
+}
+
+// 在算子中同步运行另一个图
+class NestedProcessor : public GraphProcessor {
+public:
+    virtual int32_t process(GraphVertex& vertex) noexcept override {
+        auto graph = inner_builder->build();
+        auto a = graph->find_data("A");
+        auto closure = graph->run(a);
+        if (!closure.finished() || closure.error_code() != 0) {
+            return -1;
+        }
+        *vertex.anonymous_emit(0)->emit<int32_t>() = *a->cvalue<int32_t>();
+        return 0;
+    }
+
+    GraphBuilder* inner_builder {nullptr};
+};
+
+TEST(serial_executor, run_nested_graph_in_processor) {
+    ThreadSumProcessor processor;
+    GraphBuilder inner_builder;
+    build_serial_diamond(inner_builder, processor);
+    ASSERT_EQ(0, inner_builder.finish());
+
+    NestedProcessor nested_processor;
+    nested_processor.inner_builder = &inner_builder;
+    GraphBuilder builder;
+    builder.executor(SerialGraphExecutor::instance());
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("A");
+        v.anonymous_depend().to("N1");
+        v.anonymous_depend().to("N2");
+    }
+    {
+        auto& v = builder.add_vertex(nested_processor);
+        v.anonymous_emit().to("N1");
+    }
+    {
+        auto& v = builder.add_vertex(nested_processor);
+        v.anonymous_emit().to("N2");
+    }
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    auto a = graph->find_data("A");
+    ASSERT_EQ(0, graph->run(a).get());
+    ASSERT_EQ(11, *a->cvalue<int32_t>());
+}
+
+TEST(serial_executor, long_chain_not_limited_by_stack) {
+    static constexpr size_t LENGTH = 20000;
+    ThreadSumProcessor processor;
+    GraphBuilder builder;
+    builder.executor(SerialGraphExecutor::instance());
+    for (size_t i = 0; i < LENGTH; ++i) {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("C" + ::std::to_string(i));
+        if (i + 1 < LENGTH) {
+            v.anonymous_depend().to("C" + ::std::to_string(i + 1));
+        }
+    }
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    auto c = graph->find_data("C0");
+    auto closure = graph->run(c);
+    ASSERT_TRUE(closure.finished());
+    ASSERT_EQ(0, closure.error_code());
+    ASSERT_EQ(static_cast<int32_t>(LENGTH), *c->cvalue<int32_t>());
+}
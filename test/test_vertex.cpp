@@ -13,8 +13,10 @@ using ::joewu::feed::mlarch::babylon::Stack;
 using ::joewu::feed::graph::Closure;
 using ::joewu::feed::graph::ClosureContext;
 using ::joewu::feed::graph::ClosureContextImplement;
+using ::joewu::feed::graph::Graph;
 using ::joewu::feed::graph::GraphBuilder;
 using ::joewu::feed::graph::GraphData;
+using ::joewu::feed::graph::AlignedVector;
 using ::joewu::feed::graph::GraphVertex;
 using ::joewu::feed::graph::GraphFunction;
 using ::joewu::feed::graph::GraphProcessor;
@@ -89,10 +91,12 @@ class MockProcessor : public GraphProcessor {
 class VertexTest : public ::testing::Test {
 public:
     virtual void SetUp() {
-        data[0].bind(*closure);
+        // data通过所属的graph获取图规模
+        AlignedVector<GraphData>(1024).swap(graph._data);
         for (auto& one_data : data) {
-            one_data.data_num(data.size());
+            one_data.graph(graph);
         }
+        data[0].bind(*closure);
     }
     virtual void TearDown() {
         if (closure != nullptr) {
@@ -107,7 +111,8 @@ public:
     GraphVertexBuilder& builder = graph_builder.add_vertex(processor);
     GraphVertex vertex;
     ClosureContext* closure {new ClosureContextImplement<::bthread::Mutex>(executor)};
-    ::std::vector<GraphData> data {1024};
+    Graph graph;
+    AlignedVector<GraphData>& data {graph._data};
     ::std::unordered_map<::std::string, size_t> data_index_by_name;
     ::std::unordered_map<size_t, const GraphVertexBuilder*> producer_by_data_index;
     GraphVertex* _runnable_vertex[1024];
@@ -162,6 +167,32 @@ TEST_F(VertexTest, named_emit_can_get_by_name) {
     ASSERT_EQ(&data[data_index_by_name["data2"]], vertex.named_emit("y"));
 }
 
+TEST_F(VertexTest, handle_resolve_same_as_lookup) {
+    builder.anonymous_depend().to("data1");
+    builder.named_depend("x").to("data2");
+    builder.anonymous_emit().to("data3");
+    builder.named_emit("y").to("data4");
+    ASSERT_EQ(0, builder.finish(data_index_by_name, producer_by_data_index));
+    ASSERT_EQ(0, builder.build(executor, vertex, data));
+    auto x = vertex.named_dependency_handle<int32_t>("x");
+    auto a = vertex.anonymous_dependency_handle<int32_t>(0);
+    auto y = vertex.named_emit_handle("y");
+    auto e = vertex.anonymous_emit_handle(0);
+    ASSERT_TRUE(x && a && y && e);
+    ASSERT_EQ(vertex.named_dependency("x"), vertex.dependency(x));
+    ASSERT_EQ(vertex.anonymous_dependency(0), vertex.dependency(a));
+    ASSERT_EQ(vertex.named_emit("y"), vertex.emit(y));
+    ASSERT_EQ(vertex.anonymous_emit(0), vertex.emit(e));
+    // 不存在时得到无效句柄，访问返回nullptr
+    auto z = vertex.named_dependency_handle<int32_t>("z");
+    ASSERT_FALSE(z);
+    ASSERT_EQ(nullptr, vertex.dependency(z));
+    ASSERT_EQ(nullptr, vertex.value(z));
+    ASSERT_FALSE(vertex.anonymous_dependency_handle(1));
+    ASSERT_FALSE(vertex.named_emit_handle("z"));
+    ASSERT_EQ(nullptr, vertex.emit(vertex.anonymous_emit_handle(1)));
+}
+
 TEST_F(VertexTest, named_emit_is_uniq_by_name) {
     builder.named_emit("x").to("data1");
     builder.named_emit("x").to("data2");
@@ -430,3 +461,16 @@ TEST_F(VertexTest, support_reuse_obj_function) {
     *str = "1234567890";
     ASSERT_EQ(10, str->size());
 }
+
+TEST(vertex, running_state_not_share_cache_line_with_neighbour) {
+    AlignedVector<GraphVertex> vertexes(2);
+    auto line = [] (const void* address) {
+        return reinterpret_cast<uintptr_t>(address) / 64;
+    };
+    ASSERT_EQ(0, sizeof(GraphVertex) % 64);
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(&vertexes[0]._activated) % 64);
+    // 运行状态不和静态信息以及相邻vertex共用缓存行
+    ASSERT_LT(line(&vertexes[0]._graph), line(&vertexes[0]._waiting_num));
+    ASSERT_LT(line(&vertexes[0]._static_mem_manager), line(&vertexes[1]));
+    ASSERT_LT(line(&vertexes[0]._waiting_num), line(&vertexes[1]._waiting_num));
+}
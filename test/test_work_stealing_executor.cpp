@@ -0,0 +1,216 @@
+#include <thread>
+#include <future>
+#include <atomic>
+#include <vector>
+#include <inttypes.h>
+#include <gtest/gtest.h>
+#include <base/logging.h>
+#include <joewu/graph/engine/graph.h>
+#include <joewu/graph/engine/data.h>
+#include <joewu/graph/engine/vertex.h>
+#include <joewu/graph/engine/builder.h>
+#include <joewu/graph/engine/closure.h>
+#include <joewu/graph/engine/work_stealing_executor.h>
+#include "sum_processor.h"
+
+using ::joewu::feed::graph::GraphBuilder;
+using ::joewu::feed::graph::GraphProcessor;
+using ::joewu::feed::graph::GraphVertex;
+using ::joewu::feed::graph::Closure;
+using ::joewu::feed::graph::WorkStealingDeque;
+using ::joewu::feed::graph::WorkStealingGraphExecutor;
+
+TEST(work_stealing_deque, owner_pop_lifo_and_thief_steal_fifo) {
+    WorkStealingDeque<size_t> deque(2);
+    for (size_t i = 0; i < 10; ++i) {
+        deque.push(i);
+    }
+    ASSERT_EQ(10, deque.size());
+    size_t item = 0;
+    ASSERT_TRUE(deque.pop(item));
+    ASSERT_EQ(9, item);
+    ASSERT_TRUE(deque.steal(item));
+    ASSERT_EQ(0, item);
+    ASSERT_TRUE(deque.steal(item));
+    ASSERT_EQ(1, item);
+    while (deque.pop(item)) {}
+    ASSERT_TRUE(deque.empty());
+    ASSERT_FALSE(deque.steal(item));
+}
+
+TEST(work_stealing_deque, every_item_taken_exactly_once_under_concurrent_steal) {
+    static constexpr size_t ITEM_NUM = 100000;
+    static constexpr size_t THIEF_NUM = 4;
+    WorkStealingDeque<size_t> deque;
+    ::std::vector<::std::atomic<size_t>> taken(ITEM_NUM);
+    ::std::atomic<bool> done {false};
+    ::std::vector<::std::thread> thieves;
+    for (size_t i = 0; i < THIEF_NUM; ++i) {
+        thieves.emplace_back([&] {
+            size_t item = 0;
+            while (!done.load(::std::memory_order_acquire)) {
+                if (deque.steal(item)) {
+                    taken[item].fetch_add(1);
+                }
+            }
+        });
+    }
+    size_t item = 0;
+    for (size_t i = 0; i < ITEM_NUM; ++i) {
+        deque.push(i);
+        if (i % 3 == 0 && deque.pop(item)) {
+            taken[item].fetch_add(1);
+        }
+    }
+    while (deque.pop(item)) {
+        taken[item].fetch_add(1);
+    }
+    done.store(true, ::std::memory_order_release);
+    for (auto& thief : thieves) {
+        thief.join();
+    }
+    for (size_t i = 0; i < ITEM_NUM; ++i) {
+        ASSERT_EQ(1, taken[i].load()) << "item " << i;
+    }
+}
+
+TEST(work_stealing_executor, heap_allocated_parts_aligned_to_cache_line) {
+    // 不依赖aligned new，c++11下也要保证缓存行隔离
+    ::std::unique_ptr<WorkStealingGraphExecutor> executor(new WorkStealingGraphExecutor(2));
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(executor.get()) % 64);
+    for (auto& worker : executor->_workers) {
+        ASSERT_EQ(0, reinterpret_cast<uintptr_t>(worker.get()) % 64);
+    }
+}
+
+TEST(work_stealing_executor, run_diamond_graph) {
+    SumProcessor processor;
+    WorkStealingGraphExecutor executor(4);
+    ASSERT_EQ(4, executor.concurrency());
+    GraphBuilder builder;
+    builder.executor(executor);
+    build_diamond(builder, processor);
+    ASSERT_EQ(0, builder.finish());
+    for (size_t i = 0; i < 100; ++i) {
+        auto graph = builder.build();
+        auto a = graph->find_data("A");
+        ASSERT_EQ(0, graph->run(a).get());
+        ASSERT_EQ(5, *a->cvalue<int32_t>());
+    }
+}
+
+TEST(work_stealing_executor, on_finish_run_in_worker) {
+    SumProcessor processor;
+    WorkStealingGraphExecutor executor(2);
+    GraphBuilder builder;
+    builder.executor(executor);
+    build_pair(builder, processor);
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    auto a = graph->find_data("A");
+    ::std::promise<int32_t> promise;
+    auto future = promise.get_future();
+    graph->run(a).on_finish([&] (Closure&& closure) {
+        closure.wait();
+        promise.set_value(closure.error_code());
+    });
+    ASSERT_EQ(0, future.get());
+    ASSERT_EQ(2, *a->cvalue<int32_t>());
+}
+
+TEST(work_stealing_executor, concurrent_run_from_external_threads) {
+    SumProcessor processor;
+    WorkStealingGraphExecutor executor(4);
+    GraphBuilder builder;
+    builder.executor(executor);
+    build_fan_out(builder, processor, 16);
+    ASSERT_EQ(0, builder.finish());
+    ::std::vector<::std::thread> threads;
+    ::std::atomic<size_t> success {0};
+    for (size_t i = 0; i < 4; ++i) {
+        threads.emplace_back([&] {
+            for (size_t j = 0; j < 50; ++j) {
+                auto graph = builder.build();
+                auto a = graph->find_data("A");
+                if (0 == graph->run(a).get() && 17 == *a->cvalue<int32_t>()) {
+                    success++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(200, success.load());
+}
+
+// 记录批量调度情况
+class CountingExecutor : public WorkStealingGraphExecutor {
+public:
+    CountingExecutor(size_t concurrency) : WorkStealingGraphExecutor(concurrency) {}
+
+    using WorkStealingGraphExecutor::run;
+    virtual int32_t run(GraphVertex* vertexes[], size_t size) noexcept override {
+        batch_num++;
+        size_t max = max_batch_size.load();
+        while (size > max && !max_batch_size.compare_exchange_weak(max, size)) {}
+        return WorkStealingGraphExecutor::run(vertexes, size);
+    }
+
+    ::std::atomic<size_t> batch_num {0};
+    ::std::atomic<size_t> max_batch_size {0};
+};
+
+TEST(work_stealing_executor, fan_out_submitted_as_one_batch) {
+    SumProcessor processor;
+    CountingExecutor executor(4);
+    GraphBuilder builder;
+    builder.executor(executor);
+    build_wide_diamond(builder, processor, 8);
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    auto a = graph->find_data("A");
+    ASSERT_EQ(0, graph->run(a).get());
+    ASSERT_EQ(17, *a->cvalue<int32_t>());
+    // S的产出触发8个后继一次调度
+    ASSERT_EQ(8, executor.max_batch_size.load());
+}
+
+TEST(work_stealing_executor, vertex_run_in_its_own_executor) {
+    SumProcessor processor;
+    CountingExecutor shared_executor(2);
+    CountingExecutor heavy_executor(2);
+    GraphBuilder builder;
+    builder.executor(shared_executor);
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("A");
+        for (size_t i = 0; i < 4; ++i) {
+            v.anonymous_depend().to("B" + ::std::to_string(i));
+        }
+        v.anonymous_depend().to("H");
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("B" + ::std::to_string(i));
+        v.anonymous_depend().to("S");
+    }
+    {
+        auto& v = builder.add_vertex(processor).executor(heavy_executor);
+        v.anonymous_emit().to("H");
+        v.anonymous_depend().to("S");
+    }
+    {
+        auto& v = builder.add_vertex(processor);
+        v.anonymous_emit().to("S");
+    }
+    ASSERT_EQ(0, builder.finish());
+    auto graph = builder.build();
+    auto a = graph->find_data("A");
+    ASSERT_EQ(0, graph->run(a).get());
+    ASSERT_EQ(11, *a->cvalue<int32_t>());
+    // S的后继按executor分为两批提交
+    ASSERT_EQ(1, heavy_executor.batch_num.load());
+    ASSERT_EQ(1, heavy_executor.max_batch_size.load());
+    ASSERT_EQ(4, shared_executor.max_batch_size.load());
+}